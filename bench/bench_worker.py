@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""
+Benchmark of the worker.py image pipeline
+Times each processing stage over the input/ corpus and compares the sizes of
+the three formats the device can download: PNG, plain raw 4bpp and LZ4 raw
+(a deflated raw is listed as a gauge of what heavier compression would save).
+With --device-data, writes sample images in all three formats into bench/data
+for the device decode benchmark (env:m5papers3_bench in platformio.ini).
+"""
+
+import argparse
+import io
+import shutil
+import statistics
+import sys
+import time
+import zlib
+from pathlib import Path
+
+from PIL import Image, ImageOps
+import numpy as np
+
+REPO_DIR = Path(__file__).resolve().parent.parent
+sys.path.insert(0, str(REPO_DIR))
+
+import worker  # noqa: E402
+
+DEVICE_DATA_DIR = REPO_DIR / "bench" / "data"
+DEVICE_SAMPLES = 3  # Images copied for the device benchmark (each as PNG and raw)
+INPUT_EXTENSIONS = {".jpg", ".jpeg", ".png"}  # What process_new_images() picks up
+
+STAGES = ["load", "grayscale", "unsharp", "gamma+levels", "dither", "png encode", "raw pack", "lz4 encode"]
+
+def time_stage(timings, stage, fn, *args):
+    """
+    Run fn(*args), adding its wall time in ms to timings[stage]
+    """
+    start = time.perf_counter()
+    result = fn(*args)
+    timings.setdefault(stage, []).append((time.perf_counter() - start) * 1000.0)
+    return result
+
+def load_image(input_path):
+    """
+    Open, orient, crop and resize as process_image() does
+    """
+    img = ImageOps.exif_transpose(Image.open(input_path))
+    if img.mode != 'RGB':
+        img = img.convert('RGB')
+    img = worker.center_crop(img, worker.TARGET_WIDTH, worker.TARGET_HEIGHT)
+    return img.resize((worker.TARGET_WIDTH, worker.TARGET_HEIGHT), Image.Resampling.LANCZOS)
+
+def readable(input_path):
+    """
+    True if the input opens as an image; worker.py reports and skips the others too
+    """
+    try:
+        with Image.open(input_path) as img:
+            img.verify()
+        return True
+    except Exception as e:
+        print(f"Skipping {input_path.name}: {e}")
+        return False
+
+def encode_png(img):
+    buffer = io.BytesIO()
+    img.save(buffer, 'PNG', optimize=True)
+    return buffer.getvalue()
+
+def bench_image(input_path, timings, sizes):
+    """
+    One pass of the pipeline over one image, stage by stage
+    Mirrors convert_to_4bit_grayscale() so the stages can be timed apart
+    """
+    img = time_stage(timings, "load", load_image, input_path)
+    img = time_stage(timings, "grayscale", worker.color_aware_grayscale, img)
+    img = time_stage(timings, "unsharp", worker.apply_unsharp_mask, img, worker.UNSHARP_RADIUS, worker.UNSHARP_AMOUNT)
+
+    gray = np.asarray(img)
+    pixels = time_stage(timings, "gamma+levels", lambda: worker.gamma_levels_lut(gray, gamma=worker.GAMMA)[gray])
+    time_stage(timings, "dither", worker.get_dither_kernel(), pixels)
+    img = Image.fromarray(np.clip(pixels, 0, 255).astype(np.uint8), mode='L')
+
+    png = time_stage(timings, "png encode", encode_png, img)
+    packed = time_stage(timings, "raw pack", worker.pack_4bpp, img)
+    compressed = time_stage(timings, "lz4 encode", worker.lz4_compress, packed)
+
+    sizes["png"].append(len(png))
+    sizes["raw4"].append(worker.RAW_HEADER.size + len(packed))
+    sizes["raw4 lz4"].append(worker.RAW_HEADER.size + len(compressed))
+    sizes["raw4 deflated"].append(worker.RAW_HEADER.size + len(zlib.compress(packed, 9)))
+
+def print_report(timings, sizes):
+    print(f"\n{'stage':<14}{'median ms':>10}{'min ms':>10}{'max ms':>10}{'total ms':>11}")
+    for stage in STAGES:
+        values = timings.get(stage, [])
+        if values:
+            print(f"{stage:<14}{statistics.median(values):>10.1f}{min(values):>10.1f}"
+                  f"{max(values):>10.1f}{sum(values):>11.1f}")
+    per_image = sum(sum(v) for v in timings.values()) / max(len(timings.get("load", [])), 1)
+    print(f"{'per image':<14}{per_image:>10.1f}")
+
+    print(f"\n{'output':<14}{'mean KB':>10}{'min KB':>10}{'max KB':>10}{'vs png':>9}")
+    png_mean = statistics.mean(sizes["png"])
+    for name, values in sizes.items():
+        mean = statistics.mean(values)
+        print(f"{name:<14}{mean / 1024:>10.1f}{min(values) / 1024:>10.1f}"
+              f"{max(values) / 1024:>10.1f}{mean / png_mean:>8.0%}")
+
+def copy_device_samples():
+    """
+    Write the newest outputs into bench/data for the device benchmark: the PNG,
+    and raw files of both versions made from it
+    """
+    DEVICE_DATA_DIR.mkdir(parents=True, exist_ok=True)
+    outputs = list((REPO_DIR / worker.OUTPUT_DIR).glob("*.png")) + list((REPO_DIR / worker.IMAGE_DIR).glob("*.png"))
+    samples = sorted(outputs, key=lambda p: p.name)[-DEVICE_SAMPLES:]
+    if not samples:
+        sys.exit("No processed images in output/ or image/: run worker.py first")
+
+    for png in samples:
+        shutil.copy2(png, DEVICE_DATA_DIR / png.name)
+        print(f"Copied {png} to {DEVICE_DATA_DIR}")
+        img = Image.open(png).convert('L')
+        worker.save_raw(img, DEVICE_DATA_DIR / (png.stem + worker.RAW_EXTENSION), lz4=False)
+        worker.save_raw(img, DEVICE_DATA_DIR / (png.stem + "_lz4" + worker.RAW_EXTENSION), lz4=True)
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark the worker.py image pipeline")
+    parser.add_argument("--input", type=Path, default=REPO_DIR / worker.INPUT_DIR,
+                        help="folder of source images (default: input/)")
+    parser.add_argument("--limit", type=int, default=0, help="only the first N images (default: all)")
+    parser.add_argument("--repeat", type=int, default=1, help="passes over the corpus (default: 1)")
+    parser.add_argument("--dither-kernel", choices=["auto", "native", "python"], default="auto",
+                        help="Floyd-Steinberg implementation to time (default: auto)")
+    parser.add_argument("--device-data", action="store_true",
+                        help="only write sample images into bench/data for env:m5papers3_bench")
+    args = parser.parse_args()
+
+    worker.DITHER_KERNEL = args.dither_kernel
+
+    if args.device_data:
+        copy_device_samples()
+        return
+
+    inputs = sorted(p for p in args.input.iterdir() if p.suffix.lower() in INPUT_EXTENSIONS)
+    inputs = [p for p in inputs if readable(p)]
+    if args.limit:
+        inputs = inputs[:args.limit]
+    if not inputs:
+        sys.exit(f"No readable images in {args.input}")
+
+    timings = {}
+    sizes = {"png": [], "raw4": [], "raw4 lz4": [], "raw4 deflated": []}
+    worker.get_dither_kernel()  # Build/load the native kernel outside the timings
+    for _ in range(args.repeat):
+        for input_path in inputs:
+            bench_image(input_path, timings, sizes)
+
+    print(f"\n{len(inputs)} images x {args.repeat} passes, dither kernel: {args.dither_kernel}")
+    print_report(timings, sizes)
+
+if __name__ == "__main__":
+    main()
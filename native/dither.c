@@ -0,0 +1,39 @@
+/*
+ * Floyd-Steinberg dithering to 16 gray levels for worker.py
+ *
+ * Same arithmetic as the Python loop in convert_to_4bit_grayscale(), one
+ * float32 operation at a time in the same order, so the output is
+ * bit-identical. Build without -ffast-math and with -ffp-contract=off
+ * (worker.py does this): a fused multiply-add would change the rounding.
+ */
+
+#include <math.h>
+
+void dither_fs16(float *pixels, int width, int height)
+{
+    for (int y = 0; y < height; y++) {
+        float *row = pixels + (long)y * width;
+        float *next = row + width;
+
+        for (int x = 0; x < width; x++) {
+            float old_pixel = row[x];
+
+            /* Quantize to 16 levels (0, 17, 34, ..., 255), rounding half to even like np.round */
+            float new_pixel = rintf(old_pixel / 17.0f) * 17.0f;
+            row[x] = new_pixel;
+
+            float error = old_pixel - new_pixel;
+
+            /* Distribute error to neighboring pixels */
+            if (x + 1 < width)
+                row[x + 1] += error * 7.0f / 16.0f;
+            if (y + 1 < height) {
+                if (x > 0)
+                    next[x - 1] += error * 3.0f / 16.0f;
+                next[x] += error * 5.0f / 16.0f;
+                if (x + 1 < width)
+                    next[x + 1] += error * 1.0f / 16.0f;
+            }
+        }
+    }
+}
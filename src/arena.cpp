@@ -0,0 +1,85 @@
+#include "arena.h"
+#include "display.h"
+
+#define ARENA_ALIGN 16
+#define ALIGN_UP(n) (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+static const char* const regionNames[ARENA_REGION_COUNT] = {"net", "ring", "scratch", "frame"};
+
+// Capacity of each region, in the order they are laid out in the block
+static const size_t regionSize[ARENA_REGION_COUNT] = {
+    ALIGN_UP(ARENA_NET_SIZE),
+    ALIGN_UP(PIPELINE_RING_SIZE),
+    ALIGN_UP((size_t)IMAGE_WIDTH * IMAGE_HEIGHT),
+    ALIGN_UP(FRAME_SIZE),
+};
+
+// Highest use of each region over the wakes since power-on
+RTC_DATA_ATTR static uint32_t highWater[ARENA_REGION_COUNT];
+
+static uint8_t* block = nullptr;
+static uint8_t* regionBase[ARENA_REGION_COUNT];
+static size_t regionUsed[ARENA_REGION_COUNT];
+
+bool arenaInit() {
+    if (block) {
+        return true;
+    }
+
+    size_t total = 0;
+    for (int r = 0; r < ARENA_REGION_COUNT; r++) {
+        total += regionSize[r];
+    }
+
+#ifdef BOARD_HAS_PSRAM
+    block = (uint8_t*)heap_caps_aligned_alloc(ARENA_ALIGN, total, MALLOC_CAP_SPIRAM);
+#else
+    block = (uint8_t*)heap_caps_aligned_alloc(ARENA_ALIGN, total, MALLOC_CAP_8BIT);
+#endif
+    if (!block) {
+        Serial.printf("Failed to allocate %u byte arena\n", (unsigned)total);
+        return false;
+    }
+
+    uint8_t* base = block;
+    for (int r = 0; r < ARENA_REGION_COUNT; r++) {
+        regionBase[r] = base;
+        base += regionSize[r];
+    }
+    arenaReset();
+    return true;
+}
+
+void* arenaAlloc(ArenaRegion region, size_t size) {
+    if (!block && !arenaInit()) {
+        return nullptr;
+    }
+
+    size_t offset = regionUsed[region];
+    size = ALIGN_UP(size);
+    if (size > regionSize[region] - offset) {
+        Serial.printf("Arena region %s full: %u of %u bytes used, %u more wanted\n", regionNames[region], (unsigned)offset,
+                      (unsigned)regionSize[region], (unsigned)size);
+        return nullptr;
+    }
+
+    regionUsed[region] = offset + size;
+    if (regionUsed[region] > highWater[region]) {
+        highWater[region] = regionUsed[region];
+    }
+    return regionBase[region] + offset;
+}
+
+void arenaReset() {
+    memset(regionUsed, 0, sizeof(regionUsed));
+}
+
+void arenaReport() {
+    char line[160];
+    int len = snprintf(line, sizeof(line), "Arena (used/peak/size):");
+    for (int r = 0; r < ARENA_REGION_COUNT && len < (int)sizeof(line); r++) {
+        len += snprintf(line + len, sizeof(line) - len, " %s %u/%u/%u", regionNames[r], (unsigned)regionUsed[r],
+                        (unsigned)highWater[r], (unsigned)regionSize[r]);
+    }
+    Serial.println(line);
+}
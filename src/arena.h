@@ -0,0 +1,43 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "config_defaults.h"
+
+/**
+ * Parts of the arena, each a fixed slice with its own bump pointer
+ */
+enum ArenaRegion {
+    ARENA_NET,      // Network receive buffer
+    ARENA_RING,     // Ring between the receive task and the decoder (pipeline.h)
+    ARENA_SCRATCH,  // Decoder scratch (the 8-bit gray canvas)
+    ARENA_FRAME,    // Packed 4bpp frame buffer
+    ARENA_REGION_COUNT
+};
+
+/**
+ * Allocate the arena: one block in PSRAM (SPI RAM) holding every region, so
+ * the large buffers never come out of the internal heap WiFi and TLS need
+ * Call once at boot; returns false if the block could not be allocated
+ */
+bool arenaInit();
+
+/**
+ * Take size bytes (16-byte aligned) from a region, nullptr if it is full
+ * Nothing is freed on its own: arenaReset() empties every region at once
+ */
+void* arenaAlloc(ArenaRegion region, size_t size);
+
+/**
+ * Empty every region (the memory stays allocated)
+ */
+void arenaReset();
+
+/**
+ * Print each region's use this wake and its high-water mark over the last
+ * wakes (kept in RTC memory); call just before deep sleep
+ */
+void arenaReport();
+
+#endif // ARENA_H
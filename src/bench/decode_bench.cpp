@@ -0,0 +1,135 @@
+// Decode benchmark (env:m5papers3_bench), built instead of main.cpp
+// Loops decode + blit over every sample image on LittleFS (uploaded from
+// bench/data with `pio run -e m5papers3_bench -t uploadfs`) and prints the
+// cycles and microseconds per frame for each, so regressions show up before
+// a build goes out to the devices.
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "../config.h"
+#include "../config_defaults.h"
+#include "../arena.h"
+#include "../decode.h"
+#include "../display.h"
+#include "../slideshow.h"
+
+/**
+ * Cycles and microseconds of the runs of one step
+ */
+struct BenchStats {
+    uint64_t cycles = 0;
+    int64_t totalUs = 0;
+    int64_t minUs = INT64_MAX;
+    int64_t maxUs = 0;
+    int runs = 0;
+
+    void add(uint32_t runCycles, int64_t us) {
+        cycles += runCycles;
+        totalUs += us;
+        minUs = min(minUs, us);
+        maxUs = max(maxUs, us);
+        runs++;
+    }
+
+    void print(const char* step) const {
+        if (!runs) {
+            Serial.printf("  %-6s failed\n", step);
+            return;
+        }
+        Serial.printf("  %-6s %9llu cycles %8lld us avg (min %lld, max %lld) over %d runs\n", step, cycles / runs,
+                      totalUs / runs, minUs, maxUs, runs);
+    }
+};
+
+enum SampleFormat {
+    FORMAT_PNG,
+    FORMAT_RAW4,
+    FORMAT_RAW4_LZ4,
+    FORMAT_UNKNOWN,
+};
+
+static const char* const formatNames[] = {"png", "raw4", "raw4 lz4", "?"};
+
+/**
+ * Format of a sample: by extension, and for raw files by the header version
+ */
+static SampleFormat formatOf(const String& path) {
+    if (path.endsWith(".png") || path.endsWith(".PNG")) {
+        return FORMAT_PNG;
+    }
+    if (!path.endsWith(".raw4")) {
+        return FORMAT_UNKNOWN;
+    }
+
+    Raw4Header header = {};
+    File file = LittleFS.open(path, "r");
+    file.read((uint8_t*)&header, sizeof(header));
+    file.close();
+    return header.version == RAW4_VERSION_LZ4 ? FORMAT_RAW4_LZ4 : FORMAT_RAW4;
+}
+
+static bool decodeSample(const String& path, SampleFormat format) {
+    FileImageSource source;
+    if (!source.open(path)) {
+        return false;
+    }
+    bool ok = format == FORMAT_PNG ? decodeImage(&source) : decodeRawImage(&source);
+    source.close();
+    return ok;
+}
+
+static void benchSample(const String& path, SampleFormat format, size_t size) {
+    BenchStats decode;
+    BenchStats blit;
+
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint32_t startCycles = ESP.getCycleCount();
+        int64_t start = esp_timer_get_time();
+        if (!decodeSample(path, format)) {
+            break;
+        }
+        decode.add(ESP.getCycleCount() - startCycles, esp_timer_get_time() - start);
+
+        startCycles = ESP.getCycleCount();
+        start = esp_timer_get_time();
+        if (!displayBlit()) {
+            break;
+        }
+        blit.add(ESP.getCycleCount() - startCycles, esp_timer_get_time() - start);
+    }
+
+    Serial.printf("\n%s (%s, %u bytes)\n", path.c_str(), formatNames[format], (unsigned)size);
+    decode.print("decode");
+    blit.print("blit");
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(2000);  // Time to attach a serial monitor
+    Serial.printf("\n=== Decode benchmark: %d runs per image, CPU at %u MHz ===\n", BENCH_ITERATIONS, getCpuFrequencyMhz());
+
+    if (!arenaInit() || !LittleFS.begin(false)) {
+        Serial.println("No arena or no LittleFS image (upload one with -t uploadfs)");
+        return;
+    }
+
+    File root = LittleFS.open("/");
+    int samples = 0;
+    for (File file = root.openNextFile(); file; file = root.openNextFile()) {
+        String path = String("/") + file.name();
+        size_t size = file.size();
+        file.close();
+        SampleFormat format = formatOf(path);
+        if (format == FORMAT_UNKNOWN) {
+            continue;
+        }
+        benchSample(path, format, size);
+        samples++;
+    }
+
+    Serial.printf("\n=== Benchmark done: %d images ===\n", samples);
+    arenaReport();
+}
+
+void loop() {
+    delay(1000);
+}
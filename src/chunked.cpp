@@ -0,0 +1,41 @@
+#include "chunked.h"
+#include <stdlib.h>
+
+void ChunkedFraming::reset() {
+    _left = 0;
+    _last = false;
+    _done = false;
+    _line[0] = '\0';
+    _lineLen = 0;
+}
+
+bool ChunkedFraming::feed(char c) {
+    if (c != '\n') {
+        if (c != '\r' && _lineLen < sizeof(_line) - 1) {
+            _line[_lineLen++] = c;
+        }
+        return true;
+    }
+
+    _line[_lineLen] = '\0';
+    bool empty = _lineLen == 0;
+    _lineLen = 0;
+
+    if (_last) {
+        // Trailer lines up to the blank one ending the body
+        _done = empty;
+        return true;
+    }
+    if (empty) {
+        return true;  // CRLF closing the previous chunk's data
+    }
+
+    char* end;
+    unsigned long chunkSize = strtoul(_line, &end, 16);  // Extensions after ';' are ignored
+    if (end == _line) {
+        return false;
+    }
+    _left = chunkSize;
+    _last = chunkSize == 0;
+    return true;
+}
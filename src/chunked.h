@@ -0,0 +1,40 @@
+#ifndef CHUNKED_H
+#define CHUNKED_H
+
+#include <stddef.h>
+
+/**
+ * Framing of an HTTP/1.1 chunked body (RFC 9112 7.1), fed one byte at a time
+ * while no chunk data is due: "<hex size>[;ext]\r\n<data>\r\n" per chunk, a
+ * zero-size chunk, then trailer lines up to a blank one. The data itself is
+ * read by the caller, at most left() bytes, and reported with consume().
+ * Free of the Arduino core, so the native unit tests can check it.
+ */
+class ChunkedFraming {
+public:
+    void reset();
+
+    /**
+     * Feed the next framing byte (only while left() is 0 and !done())
+     * Returns false if a chunk size line is malformed (see line())
+     */
+    bool feed(char c);
+
+    size_t left() const { return _left; }
+    void consume(size_t n) { _left -= n; }
+
+    // The blank line after the last chunk's trailer was read: the body ended
+    bool done() const { return _done; }
+
+    // The last size line read, for error messages
+    const char* line() const { return _line; }
+
+private:
+    size_t _left = 0;     // Data bytes left in the current chunk
+    bool _last = false;   // Zero-size chunk seen, reading the trailer
+    bool _done = false;
+    char _line[24] = {0};  // Chunk size line being read
+    size_t _lineLen = 0;
+};
+
+#endif // CHUNKED_H
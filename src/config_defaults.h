@@ -0,0 +1,91 @@
+#ifndef CONFIG_DEFAULTS_H
+#define CONFIG_DEFAULTS_H
+
+#include "config.h"
+
+// Defaults for options newer than some existing config.h files, kept in this one
+// place so that the firmware and the benchmark always build with the same values.
+// Include right after config.h wherever an option is used; see config.h.template
+// for what each option does.
+
+// WiFi
+#ifndef WIFI_CONNECT_TIMEOUT_MS
+#define WIFI_CONNECT_TIMEOUT_MS 15000
+#endif
+#ifndef WIFI_FAST_CONNECT_TIMEOUT_MS
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 2000
+#endif
+#ifndef WIFI_DHCP_REFRESH_WAKES
+#define WIFI_DHCP_REFRESH_WAKES 48
+#endif
+
+// Fleet
+#ifndef DEVICE_ID
+#define DEVICE_ID ""
+#endif
+
+// Wake scheduling
+#ifndef SLEEP_MIN_US
+#define SLEEP_MIN_US (SLEEP_DURATION_US / 3)
+#endif
+#ifndef SLEEP_MAX_US
+#define SLEEP_MAX_US (8 * 60 * 60 * 1000000ULL)
+#endif
+#ifndef SLEEP_JITTER_PERCENT
+#define SLEEP_JITTER_PERCENT 10
+#endif
+#ifndef BURST_IMAGES
+#define BURST_IMAGES 3
+#endif
+#ifndef BURST_WINDOW_S
+#define BURST_WINDOW_S (6 * 3600)
+#endif
+#ifndef QUIET_HOURS_START
+#define QUIET_HOURS_START 0
+#endif
+#ifndef QUIET_HOURS_END
+#define QUIET_HOURS_END 0  // Same as the start: no quiet hours
+#endif
+#ifndef TIMEZONE
+#define TIMEZONE "UTC0"
+#endif
+#ifndef BATTERY_LOW_MV
+#define BATTERY_LOW_MV 3600
+#endif
+#ifndef BATTERY_CRITICAL_MV
+#define BATTERY_CRITICAL_MV 3400
+#endif
+
+// Panel
+#ifndef FULL_REFRESH_INTERVAL
+#define FULL_REFRESH_INTERVAL 10
+#endif
+#ifndef PARTIAL_REFRESH_MAX_PERCENT
+#define PARTIAL_REFRESH_MAX_PERCENT 20
+#endif
+#ifndef PANEL_GAMMA
+#define PANEL_GAMMA 1.0
+#endif
+#ifndef PANEL_CONTRAST
+#define PANEL_CONTRAST 1.0
+#endif
+
+// Slideshow
+#ifndef SLIDESHOW_SIZE
+#define SLIDESHOW_SIZE 1
+#endif
+
+// Memory
+#ifndef ARENA_NET_SIZE
+#define ARENA_NET_SIZE (16 * 1024)
+#endif
+#ifndef PIPELINE_RING_SIZE
+#define PIPELINE_RING_SIZE (32 * 1024)
+#endif
+
+// Decode benchmark (env:m5papers3_bench)
+#ifndef BENCH_ITERATIONS
+#define BENCH_ITERATIONS 10
+#endif
+
+#endif // CONFIG_DEFAULTS_H
@@ -0,0 +1,224 @@
+#include "decode.h"
+#include "display.h"
+#include "lz4.h"
+#include "timing.h"
+
+bool decodeImage(ImageSource* imageStream) {
+    Serial.println("\n=== Decoding Image ===");
+
+    // Decode time is what the decoder itself took, not the waits for bytes
+    int64_t decodeStart = esp_timer_get_time();
+    int64_t downloadBefore = timingGet(PHASE_DOWNLOAD);
+    bool success = displayDrawPng(imageStream);
+    timingAdd(PHASE_DECODE, esp_timer_get_time() - decodeStart - (timingGet(PHASE_DOWNLOAD) - downloadBefore));
+
+    if (success) {
+        imageStream->readToEnd();
+    }
+    if (success && !imageStream->complete()) {
+        Serial.printf("Download incomplete: %d/%d bytes\n", imageStream->received(), imageStream->size());
+        success = false;
+    }
+
+    if (!success) {
+        Serial.println("Failed to decode image");
+    }
+    return success;
+}
+
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t len) {
+    static uint32_t table[256];
+    if (!table[1]) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+    }
+
+    crc = ~crc;
+    while (len--) {
+        crc = table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/**
+ * Read exactly len bytes from the download stream
+ */
+static bool readFully(ImageSource* imageStream, uint8_t* buf, size_t len) {
+    size_t filled = 0;
+    while (filled < len) {
+        int n = imageStream->read(buf + filled, len - filled);
+        if (n <= 0) {
+            return false;
+        }
+        filled += n;
+    }
+    return true;
+}
+
+bool decodeRawImage(ImageSource* imageStream) {
+    Serial.println("\n=== Reading Image (raw 4bpp) ===");
+
+    Raw4Header header;
+    if (!readFully(imageStream, (uint8_t*)&header, sizeof(header))) {
+        Serial.println("Download incomplete: no raw header");
+        return false;
+    }
+
+    size_t frameSize = (size_t)header.width * header.height / 2;
+    bool compressed = header.version == RAW4_VERSION_LZ4;
+    if (memcmp(header.magic, RAW4_MAGIC, 4) != 0 || !RAW4_VERSION_SUPPORTED(header.version) ||
+        header.width != IMAGE_WIDTH || header.height != IMAGE_HEIGHT ||
+        (!compressed && imageStream->size() != sizeof(header) + frameSize)) {
+        Serial.println("Invalid raw image header");
+        return false;
+    }
+
+    // Fill the frame as bytes arrive, checking the CRC along the way
+    uint8_t* frame = displayFrame();
+    if (!frame) {
+        return false;
+    }
+    int64_t decodeStart = esp_timer_get_time();
+    int64_t downloadBefore = timingGet(PHASE_DOWNLOAD);
+    uint32_t crc = 0;
+    size_t filled = 0;
+    if (compressed) {
+        int n = inflateLz4(imageStream, frame, frameSize);
+        if (n > 0) {
+            filled = n;
+            crc = crc32Update(crc, frame, filled);
+        }
+        if (n < 0) {
+            Serial.println("Corrupt LZ4 data");
+            return false;
+        }
+    } else {
+        while (filled < frameSize) {
+            int n = imageStream->read(frame + filled, frameSize - filled);
+            if (n <= 0) {
+                break;
+            }
+            crc = crc32Update(crc, frame + filled, n);
+            filled += n;
+        }
+    }
+    timingAdd(PHASE_DECODE, esp_timer_get_time() - decodeStart - (timingGet(PHASE_DOWNLOAD) - downloadBefore));
+
+    if (filled != frameSize) {
+        Serial.printf("Download incomplete: %d/%d bytes\n", imageStream->received(), imageStream->size());
+        return false;
+    }
+
+    if (crc != header.crc32) {
+        Serial.println("Raw image CRC mismatch");
+        return false;
+    }
+
+    return true;
+}
+
+bool decodeDelta(ImageSource* imageStream, const char* baseName) {
+    Serial.println("\n=== Applying Delta ===");
+
+    Delta4Header header;
+    if (!readFully(imageStream, (uint8_t*)&header, sizeof(header))) {
+        Serial.println("Download incomplete: no delta header");
+        return false;
+    }
+
+    int tile = header.tileSize;
+    if (memcmp(header.magic, DELTA4_MAGIC, 4) != 0 || header.version != DELTA4_VERSION ||
+        header.width != IMAGE_WIDTH || header.height != IMAGE_HEIGHT || tile < 2 || tile % 2 ||
+        IMAGE_WIDTH % tile || IMAGE_HEIGHT % tile) {
+        Serial.println("Invalid delta header");
+        return false;
+    }
+    if (strncmp(header.base, baseName, sizeof(header.base)) != 0) {
+        Serial.printf("Delta is against %.32s, not %s\n", header.base, baseName);
+        return false;
+    }
+
+    uint8_t* frame = displayFrame();
+    uint8_t* scratch = displayScratch();
+    if (!frame || !scratch) {
+        return false;
+    }
+
+    // The changed tiles take at most the first FRAME_SIZE bytes of the scratch canvas,
+    // the bitmap (up to IMAGE_WIDTH * IMAGE_HEIGHT / 32 bytes) goes after them
+    static_assert(IMAGE_WIDTH * IMAGE_HEIGHT >= FRAME_SIZE + IMAGE_WIDTH * IMAGE_HEIGHT / 32,
+                  "Scratch canvas too small for the delta bitmap");
+    int tilesX = IMAGE_WIDTH / tile;
+    int tiles = tilesX * (IMAGE_HEIGHT / tile);
+    uint8_t* bitmap = scratch + FRAME_SIZE;
+    bool success = false;
+    if (!readFully(imageStream, bitmap, (tiles + 7) / 8)) {
+        Serial.println("Download incomplete: no delta bitmap");
+    } else {
+        int changed = 0;
+        for (int t = 0; t < tiles; t++) {
+            changed += (bitmap[t / 8] >> (7 - t % 8)) & 1;
+        }
+
+        // Every changed tile at once fits in the canvas: at most the frame size
+        size_t tileRow = tile / 2;
+        size_t dataSize = (size_t)changed * tile * tileRow;
+        int64_t decodeStart = esp_timer_get_time();
+        int64_t downloadBefore = timingGet(PHASE_DOWNLOAD);
+        int n = changed == header.changedTiles ? inflateLz4(imageStream, scratch, dataSize) : -1;
+        if (n == (int)dataSize) {
+            const uint8_t* src = scratch;
+            for (int t = 0; t < tiles; t++) {
+                if (!((bitmap[t / 8] >> (7 - t % 8)) & 1)) {
+                    continue;
+                }
+                uint8_t* dst = frame + (size_t)(t / tilesX) * tile * FRAME_STRIDE + (t % tilesX) * tileRow;
+                for (int y = 0; y < tile; y++, dst += FRAME_STRIDE, src += tileRow) {
+                    memcpy(dst, src, tileRow);
+                }
+            }
+        }
+        timingAdd(PHASE_DECODE, esp_timer_get_time() - decodeStart - (timingGet(PHASE_DOWNLOAD) - downloadBefore));
+
+        if (n < 0) {
+            Serial.println("Corrupt delta data");
+        } else if (n != (int)dataSize) {
+            Serial.printf("Download incomplete: %d/%d bytes\n", imageStream->received(), imageStream->size());
+        } else if (crc32Update(0, frame, FRAME_SIZE) != header.crc32) {
+            Serial.println("Delta result CRC mismatch");
+        } else {
+            Serial.printf("Applied %d/%d changed tiles\n", changed, tiles);
+            success = true;
+        }
+    }
+    return success;
+}
+
+bool saveRawImage(const char* path) {
+    uint8_t* frame = displayFrame();
+    if (!frame) {
+        return false;
+    }
+
+    Raw4Header header = {};
+    memcpy(header.magic, RAW4_MAGIC, 4);
+    header.version = RAW4_VERSION;
+    header.width = IMAGE_WIDTH;
+    header.height = IMAGE_HEIGHT;
+    header.crc32 = crc32Update(0, frame, FRAME_SIZE);
+
+    File file = LittleFS.open(path, "w");
+    bool success = file && file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+                   file.write(frame, FRAME_SIZE) == FRAME_SIZE;
+    file.close();
+    if (!success) {
+        Serial.printf("Failed to write %s\n", path);
+        LittleFS.remove(path);
+    }
+    return success;
+}
@@ -0,0 +1,80 @@
+#ifndef DECODE_H
+#define DECODE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "config_defaults.h"
+#include "slideshow.h"
+
+// Raw 4bpp format written by worker.py (see save_raw()): header, then rows of
+// packed pixels, two per byte, left pixel in the high nibble, 0 = black ... 15 = white
+// Version 2 stores the same pixels as one LZ4 block
+#define RAW4_MAGIC "EPD4"
+#define RAW4_VERSION 1
+#define RAW4_VERSION_LZ4 2
+
+#define RAW4_VERSION_SUPPORTED(v) ((v) == RAW4_VERSION || (v) == RAW4_VERSION_LZ4)
+
+struct __attribute__((packed)) Raw4Header {
+    char magic[4];
+    uint8_t version;
+    uint8_t flags;
+    uint16_t width;
+    uint16_t height;
+    uint16_t reserved;
+    uint32_t crc32;  // CRC-32 (zlib) of the pixel data
+};
+
+// Delta format written by worker.py (see save_delta()): the tiles of a new image
+// that differ from the image before it. Header, then a bitmap of the changed
+// tiles (row-major, most significant bit first), then one LZ4 block of their
+// packed rows, tile after tile
+#define DELTA4_MAGIC "EPDD"
+#define DELTA4_VERSION 1
+
+struct __attribute__((packed)) Delta4Header {
+    char magic[4];
+    uint8_t version;
+    uint8_t tileSize;       // Tile side in pixels, even
+    uint16_t width;
+    uint16_t height;
+    uint16_t changedTiles;  // Bits set in the bitmap
+    uint32_t crc32;         // CRC-32 (zlib) of the pixel data of the new image
+    char base[32];          // Image the delta applies to, NUL padded
+};
+
+/**
+ * Decode a PNG from the download stream (or a cached file) into the frame
+ * Rows go to the frame buffer as they are inflated; succeeds only if the whole
+ * file arrived and decoded. The panel is not touched.
+ */
+bool decodeImage(ImageSource* imageStream);
+
+/**
+ * Read a raw 4bpp image from the download stream (or a cached file) into the frame
+ * The pixel data is already in the layout of the frame buffer, so it is read
+ * straight into it: no decode step at all. An LZ4 file is decompressed into the
+ * frame as it streams in, its matches copied from the frame itself.
+ * The panel is not touched.
+ */
+bool decodeRawImage(ImageSource* imageStream);
+
+/**
+ * Apply a delta from the download stream to the frame, which must hold its base
+ * image (named baseName). The changed tiles are decompressed into the decode
+ * canvas, then copied over; the result is checked against the new image's CRC.
+ * The panel is not touched.
+ */
+bool decodeDelta(ImageSource* imageStream, const char* baseName);
+
+/**
+ * Write the frame as a plain raw 4bpp file, to decode again on a later wake
+ */
+bool saveRawImage(const char* path);
+
+/**
+ * Update a CRC-32 (same polynomial and conventions as zlib.crc32)
+ */
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t len);
+
+#endif // DECODE_H
@@ -0,0 +1,435 @@
+#include "display.h"
+#include "arena.h"
+#include "graylut.h"
+#include "timing.h"
+#include <FastEPD.h>
+
+// Native panel geometry (the PaperS3 panel is scanned in landscape)
+#define NATIVE_WIDTH 960
+#define NATIVE_HEIGHT 540
+
+#if DISPLAY_ROTATION % 2 == 0
+static_assert(IMAGE_WIDTH == NATIVE_HEIGHT && IMAGE_HEIGHT == NATIVE_WIDTH, "Portrait rotation needs a 540x960 image");
+#else
+static_assert(IMAGE_WIDTH == NATIVE_WIDTH && IMAGE_HEIGHT == NATIVE_HEIGHT, "Landscape rotation needs a 960x540 image");
+#endif
+
+// Change detection grid: one hash per TILE_SIZE x TILE_SIZE block of the frame
+#define TILE_SIZE 30
+#define TILES_X (IMAGE_WIDTH / TILE_SIZE)
+#define TILES_Y (IMAGE_HEIGHT / TILE_SIZE)
+static_assert(IMAGE_WIDTH % TILE_SIZE == 0 && IMAGE_HEIGHT % TILE_SIZE == 0, "Tiles must cover the frame");
+static_assert(TILE_SIZE % 2 == 0, "Tiles must start on a byte boundary");
+
+// More separate changed regions than this are refreshed as one bounding box:
+// every partial update pays the waveform time, however small it is
+#define MAX_REGIONS 8
+
+/**
+ * Rectangle of tiles, inclusive
+ */
+struct TileRect {
+    uint8_t x0, y0, x1, y1;
+};
+
+/**
+ * What is on the panel, kept across deep sleep (the frame buffer is not)
+ */
+struct PanelHistory {
+    bool valid;                           // tileHash describes the panel content
+    uint16_t updatesSinceFull;            // Updates without a clearing flash
+    uint32_t tileHash[TILES_Y][TILES_X];
+};
+
+RTC_DATA_ATTR static PanelHistory history = {};
+
+static FASTEPD epaper;
+static bool panelReady = false;
+static uint8_t* frame = nullptr;
+static M5Canvas* canvas = nullptr;  // 8-bit gray scratch for PNG decode and text
+
+static const char* refreshModeName(RefreshMode mode) {
+    switch (mode) {
+        case REFRESH_NONE: return "none";
+        case REFRESH_FULL: return "full";
+        case REFRESH_FAST: return "fast";
+        case REFRESH_PARTIAL: return "partial";
+    }
+    return "?";
+}
+
+uint8_t* displayFrame() {
+    if (!frame) {
+        frame = (uint8_t*)arenaAlloc(ARENA_FRAME, FRAME_SIZE);
+        if (!frame) {
+            Serial.println("Failed to allocate frame buffer");
+        }
+    }
+    return frame;
+}
+
+/**
+ * Gray scratch canvas the size of the frame, drawing into the arena's scratch region
+ */
+static M5Canvas* scratchCanvas() {
+    if (!canvas) {
+        void* buffer = arenaAlloc(ARENA_SCRATCH, (size_t)IMAGE_WIDTH * IMAGE_HEIGHT);
+        if (!buffer) {
+            Serial.println("Failed to allocate decode canvas");
+            return nullptr;
+        }
+        canvas = new M5Canvas();
+        canvas->setBuffer(buffer, IMAGE_WIDTH, IMAGE_HEIGHT, lgfx::color_depth_t::grayscale_8bit);
+    }
+    return canvas;
+}
+
+uint8_t* displayScratch() {
+    M5Canvas* target = scratchCanvas();
+    return target ? (uint8_t*)target->getBuffer() : nullptr;
+}
+
+/**
+ * Quantize the gray scratch canvas into the packed 4bpp frame
+ */
+static bool packCanvasToFrame(M5Canvas* source) {
+    uint8_t* dst = displayFrame();
+    if (!dst) {
+        return false;
+    }
+
+    const uint8_t* src = (const uint8_t*)source->getBuffer();
+    for (size_t i = 0; i < FRAME_SIZE; i++) {
+        dst[i] = GRAY_TO_LEVEL[src[2 * i]] << 4 | GRAY_TO_LEVEL[src[2 * i + 1]];
+    }
+    return true;
+}
+
+bool displayDrawPng(lgfx::DataWrapper* data) {
+    M5Canvas* target = scratchCanvas();
+    if (!target) {
+        return false;
+    }
+
+    target->fillScreen(TFT_WHITE);
+    if (!target->drawPng(data, 0, 0, IMAGE_WIDTH, IMAGE_HEIGHT)) {
+        return false;
+    }
+    return packCanvasToFrame(target);
+}
+
+bool displayDrawError(const char* message) {
+    M5Canvas* target = scratchCanvas();
+    if (!target) {
+        return false;
+    }
+
+    target->fillScreen(TFT_WHITE);
+    target->setTextColor(TFT_BLACK);
+    target->setTextSize(3);
+    target->drawString("Error:", 20, 100);
+    target->setTextSize(2);
+    target->drawString(message, 20, 150);
+    return packCanvasToFrame(target);
+}
+
+/**
+ * Map a logical frame coordinate to the native panel coordinate
+ */
+static inline void toNative(int x, int y, int* nx, int* ny) {
+#if DISPLAY_ROTATION == 0
+    *nx = y;
+    *ny = NATIVE_HEIGHT - 1 - x;
+#elif DISPLAY_ROTATION == 1
+    *nx = x;
+    *ny = y;
+#elif DISPLAY_ROTATION == 2
+    *nx = NATIVE_WIDTH - 1 - y;
+    *ny = x;
+#else
+    *nx = NATIVE_WIDTH - 1 - x;
+    *ny = NATIVE_HEIGHT - 1 - y;
+#endif
+}
+
+static inline uint8_t framePixel(int x, int y) {
+    uint8_t b = frame[y * FRAME_STRIDE + (x >> 1)];
+    return (x & 1) ? (b & 0x0F) : (b >> 4);
+}
+
+/**
+ * Copy the frame into FastEPD's 4bpp buffer (native layout, high nibble first),
+ * through the panel tuning table, in one pass
+ * The portrait rotations turn frame columns into native rows: two frame rows
+ * are read together, so each pair of frame bytes gives one byte of two native rows.
+ */
+static void blitFrame4bpp(uint8_t* native) {
+#if DISPLAY_ROTATION == 1
+    for (size_t i = 0; i < FRAME_SIZE; i++) {
+        native[i] = PANEL_PAIR[frame[i]];
+    }
+#elif DISPLAY_ROTATION == 3
+    // Rotated 180 degrees: bytes in reverse order, nibbles swapped
+    for (size_t i = 0; i < FRAME_SIZE; i++) {
+        uint8_t v = PANEL_PAIR[frame[FRAME_SIZE - 1 - i]];
+        native[i] = v << 4 | v >> 4;
+    }
+#else
+    const int nativeStride = NATIVE_WIDTH / 2;
+    for (int y = 0; y < IMAGE_HEIGHT; y += 2) {
+        const uint8_t* top = frame + y * FRAME_STRIDE;
+        const uint8_t* bottom = top + FRAME_STRIDE;
+        for (int bx = 0; bx < FRAME_STRIDE; bx++) {
+            uint8_t a = PANEL_PAIR[top[bx]];     // Pixels (2bx, y) and (2bx + 1, y)
+            uint8_t b = PANEL_PAIR[bottom[bx]];  // The same two columns on row y + 1
+#if DISPLAY_ROTATION == 0
+            // Column x goes to native row NATIVE_HEIGHT - 1 - x, row y to native column y
+            native[(NATIVE_HEIGHT - 1 - 2 * bx) * nativeStride + y / 2] = (a & 0xF0) | b >> 4;
+            native[(NATIVE_HEIGHT - 2 - 2 * bx) * nativeStride + y / 2] = a << 4 | (b & 0x0F);
+#else
+            // Column x goes to native row x, row y to native column NATIVE_WIDTH - 1 - y
+            native[2 * bx * nativeStride + (NATIVE_WIDTH - 2 - y) / 2] = (b & 0xF0) | a >> 4;
+            native[(2 * bx + 1) * nativeStride + (NATIVE_WIDTH - 2 - y) / 2] = b << 4 | (a & 0x0F);
+#endif
+        }
+    }
+#endif
+}
+
+/**
+ * Copy the frame into FastEPD's 1bpp buffer (native layout, MSB first, 1 = white)
+ */
+static void blitFrame1bpp(uint8_t* native) {
+    memset(native, 0, NATIVE_WIDTH / 8 * NATIVE_HEIGHT);
+    for (int y = 0; y < IMAGE_HEIGHT; y++) {
+        for (int x = 0; x < IMAGE_WIDTH; x++) {
+            if (framePixel(x, y) >= 8) {
+                int nx, ny;
+                toNative(x, y, &nx, &ny);
+                native[ny * (NATIVE_WIDTH / 8) + (nx >> 3)] |= 0x80 >> (nx & 7);
+            }
+        }
+    }
+}
+
+/**
+ * FNV-1a hash of every tile of the frame
+ */
+static void hashTiles(uint32_t hashes[TILES_Y][TILES_X]) {
+    for (int ty = 0; ty < TILES_Y; ty++) {
+        for (int tx = 0; tx < TILES_X; tx++) {
+            uint32_t h = 2166136261u;
+            for (int y = ty * TILE_SIZE; y < (ty + 1) * TILE_SIZE; y++) {
+                const uint8_t* row = frame + y * FRAME_STRIDE + tx * (TILE_SIZE / 2);
+                for (int i = 0; i < TILE_SIZE / 2; i++) {
+                    h = (h ^ row[i]) * 16777619u;
+                }
+            }
+            hashes[ty][tx] = h;
+        }
+    }
+}
+
+/**
+ * True if every pixel is pure black or pure white (1bpp shows it losslessly)
+ */
+static bool frameIsBilevel() {
+    for (size_t i = 0; i < FRAME_SIZE; i++) {
+        uint8_t b = frame[i];
+        if ((b & 0x0F) != 0 && (b & 0x0F) != 0x0F) {
+            return false;
+        }
+        if ((b & 0xF0) != 0 && (b & 0xF0) != 0xF0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool rectsTouch(const TileRect& a, const TileRect& b) {
+    return a.x0 <= b.x1 + 1 && b.x0 <= a.x1 + 1 && a.y0 <= b.y1 + 1 && b.y0 <= a.y1 + 1;
+}
+
+/**
+ * Group changed tiles into non-touching bounding rectangles
+ * Returns the number of rectangles written to rects
+ */
+static int findChangedRegions(const bool changed[TILES_Y][TILES_X], TileRect* rects) {
+    int count = 0;
+    TileRect all = {TILES_X, TILES_Y, 0, 0};
+
+    // Start with one rectangle per horizontal run of changed tiles
+    static TileRect runs[TILES_X * TILES_Y / 2 + TILES_Y];
+    int runCount = 0;
+    for (int ty = 0; ty < TILES_Y; ty++) {
+        for (int tx = 0; tx < TILES_X; tx++) {
+            if (!changed[ty][tx]) {
+                continue;
+            }
+            int start = tx;
+            while (tx + 1 < TILES_X && changed[ty][tx + 1]) {
+                tx++;
+            }
+            runs[runCount++] = {(uint8_t)start, (uint8_t)ty, (uint8_t)tx, (uint8_t)ty};
+            all.x0 = min(all.x0, (uint8_t)start);
+            all.y0 = min(all.y0, (uint8_t)ty);
+            all.x1 = max(all.x1, (uint8_t)tx);
+            all.y1 = max(all.y1, (uint8_t)ty);
+        }
+    }
+
+    // Merge rectangles that touch until none do
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (int i = 0; i < runCount && !merged; i++) {
+            for (int j = i + 1; j < runCount; j++) {
+                if (rectsTouch(runs[i], runs[j])) {
+                    runs[i].x0 = min(runs[i].x0, runs[j].x0);
+                    runs[i].y0 = min(runs[i].y0, runs[j].y0);
+                    runs[i].x1 = max(runs[i].x1, runs[j].x1);
+                    runs[i].y1 = max(runs[i].y1, runs[j].y1);
+                    runs[j] = runs[--runCount];
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (runCount > MAX_REGIONS) {
+        rects[0] = all;
+        return 1;
+    }
+
+    for (int i = 0; i < runCount; i++) {
+        rects[count++] = runs[i];
+    }
+    return count;
+}
+
+/**
+ * Native panel rectangle covering a rectangle of tiles
+ */
+static BB_RECT nativeRect(const TileRect& r) {
+    int ax, ay, bx, by;
+    toNative(r.x0 * TILE_SIZE, r.y0 * TILE_SIZE, &ax, &ay);
+    toNative((r.x1 + 1) * TILE_SIZE - 1, (r.y1 + 1) * TILE_SIZE - 1, &bx, &by);
+
+    BB_RECT rect;
+    rect.x = min(ax, bx);
+    rect.y = min(ay, by);
+    rect.w = abs(bx - ax) + 1;
+    rect.h = abs(by - ay) + 1;
+    return rect;
+}
+
+static RefreshMode chooseRefreshMode(int changedTiles, bool bilevel) {
+    if (!history.valid || history.updatesSinceFull + 1 >= FULL_REFRESH_INTERVAL) {
+        return REFRESH_FULL;
+    }
+    if (changedTiles == 0) {
+        return REFRESH_NONE;
+    }
+    if (changedTiles * 100 <= PARTIAL_REFRESH_MAX_PERCENT * TILES_X * TILES_Y) {
+        return REFRESH_PARTIAL;
+    }
+    return bilevel ? REFRESH_FAST : REFRESH_FULL;
+}
+
+static bool initPanel() {
+    if (panelReady) {
+        return true;
+    }
+    if (epaper.initPanel(BB_PANEL_M5PAPERS3) != BBEP_SUCCESS) {
+        Serial.println("Failed to initialize e-paper panel");
+        return false;
+    }
+    panelReady = true;
+    return true;
+}
+
+bool displayBlit() {
+    if (!frame || !initPanel()) {
+        return false;
+    }
+    epaper.setMode(BB_MODE_4BPP);
+    blitFrame4bpp(epaper.currentBuffer());
+    return true;
+}
+
+bool displayPresent() {
+    if (!frame) {
+        return false;
+    }
+    PhaseTimer timer(PHASE_REFRESH);
+
+    static uint32_t hashes[TILES_Y][TILES_X];
+    static bool changed[TILES_Y][TILES_X];
+    hashTiles(hashes);
+
+    int changedTiles = 0;
+    for (int ty = 0; ty < TILES_Y; ty++) {
+        for (int tx = 0; tx < TILES_X; tx++) {
+            changed[ty][tx] = hashes[ty][tx] != history.tileHash[ty][tx];
+            changedTiles += changed[ty][tx];
+        }
+    }
+
+    bool bilevel = frameIsBilevel();
+    RefreshMode mode = chooseRefreshMode(changedTiles, bilevel);
+    Serial.printf("Refresh: %s (%d/%d tiles changed%s, %u updates since full)\n",
+                  refreshModeName(mode), changedTiles, TILES_X * TILES_Y,
+                  bilevel ? ", black/white" : "", history.updatesSinceFull);
+
+    if (mode == REFRESH_NONE) {
+        return true;
+    }
+
+    if (!initPanel()) {
+        return false;
+    }
+
+    int rc;
+    if (mode == REFRESH_FAST) {
+        epaper.setMode(BB_MODE_1BPP);
+        blitFrame1bpp(epaper.currentBuffer());
+        rc = epaper.fullUpdate(CLEAR_FAST);
+    } else if (mode == REFRESH_PARTIAL) {
+        // Only the changed regions are driven; the rest of the panel keeps its image
+        TileRect regions[MAX_REGIONS];
+        int regionCount = findChangedRegions(changed, regions);
+
+        epaper.setMode(BB_MODE_4BPP);
+        blitFrame4bpp(epaper.currentBuffer());
+
+        rc = BBEP_SUCCESS;
+        for (int i = 0; i < regionCount && rc == BBEP_SUCCESS; i++) {
+            BB_RECT rect = nativeRect(regions[i]);
+            Serial.printf("  Region %d: %dx%d at (%d,%d)\n", i, rect.w, rect.h, rect.x, rect.y);
+            rc = epaper.fullUpdate(CLEAR_NONE, i + 1 < regionCount, &rect);  // Panel stays powered between regions
+        }
+    } else {
+        epaper.setMode(BB_MODE_4BPP);
+        blitFrame4bpp(epaper.currentBuffer());
+        rc = epaper.fullUpdate(CLEAR_SLOW);
+    }
+
+    if (rc != BBEP_SUCCESS) {
+        // Unknown panel state: force a full refresh next time
+        history.valid = false;
+        Serial.printf("Panel update failed: %d\n", rc);
+        return false;
+    }
+
+    memcpy(history.tileHash, hashes, sizeof(history.tileHash));
+    history.valid = true;
+    history.updatesSinceFull = (mode == REFRESH_FULL) ? 0 : history.updatesSinceFull + 1;
+    return true;
+}
+
+void displaySleep() {
+    if (panelReady) {
+        epaper.einkPower(0);
+    }
+}
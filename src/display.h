@@ -0,0 +1,64 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <Arduino.h>
+#include <M5GFX.h>
+#include "config.h"
+#include "config_defaults.h"
+
+// Logical frame: IMAGE_WIDTH x IMAGE_HEIGHT in display orientation, packed 4bpp,
+// two pixels per byte, left pixel in the high nibble, 0 = black ... 15 = white.
+// Same layout as the pixel data of a .raw4 file.
+#define FRAME_STRIDE (IMAGE_WIDTH / 2)
+#define FRAME_SIZE ((size_t)FRAME_STRIDE * IMAGE_HEIGHT)
+
+/**
+ * How the panel is driven for one update
+ */
+enum RefreshMode {
+    REFRESH_NONE,     // Frame identical to what is on the panel
+    REFRESH_FULL,     // 4bpp grayscale with a clearing flash (removes ghosting)
+    REFRESH_FAST,     // 1bpp black/white with a fast clear, for two-level images
+    REFRESH_PARTIAL,  // Changed regions only, without the clearing flash
+};
+
+/**
+ * Frame buffer to fill before displayPresent()
+ * Taken from the arena's frame region on first use, nullptr if that fails
+ */
+uint8_t* displayFrame();
+
+/**
+ * Gray scratch canvas buffer (IMAGE_WIDTH * IMAGE_HEIGHT bytes), free to use
+ * between decodes. nullptr if that fails
+ */
+uint8_t* displayScratch();
+
+/**
+ * Decode a PNG into the frame (the panel is not touched)
+ */
+bool displayDrawPng(lgfx::DataWrapper* data);
+
+/**
+ * Render an error message into the frame (the panel is not touched)
+ */
+bool displayDrawError(const char* message);
+
+/**
+ * Push the frame to the panel, choosing the refresh mode from its content and
+ * from what changed since the previous update
+ */
+bool displayPresent();
+
+/**
+ * Copy the frame into the panel driver's 4bpp buffer without driving the panel
+ * (the first step of a full refresh; used by the decode benchmark)
+ */
+bool displayBlit();
+
+/**
+ * Power the panel down before deep sleep
+ */
+void displaySleep();
+
+#endif // DISPLAY_H
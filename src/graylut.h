@@ -0,0 +1,94 @@
+#ifndef GRAYLUT_H
+#define GRAYLUT_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "config_defaults.h"
+
+static_assert(PANEL_GAMMA > 0 && PANEL_CONTRAST > 0, "PANEL_GAMMA and PANEL_CONTRAST must be positive");
+
+// Gray level tables computed by the compiler: nothing is built at boot and the
+// per-pixel work at runtime is one lookup. Written for C++11 constexpr (single
+// return statements), the dialect the Arduino core builds with.
+namespace graylut {
+
+constexpr double LOG_2 = 0.69314718055994530942;
+
+constexpr double clamp01(double x) {
+    return x < 0 ? 0 : (x > 1 ? 1 : x);
+}
+
+constexpr double square(double x) {
+    return x * x;
+}
+
+// ln(m) = 2 atanh((m - 1) / (m + 1)), summed to k = 41: exact in double for m in [0.5, 1]
+constexpr double atanhSeries(double z2, double term, int k) {
+    return k > 41 ? 0 : term / k + atanhSeries(z2, term * z2, k + 2);
+}
+
+constexpr double lnReduced(double m) {
+    return 2 * atanhSeries(square((m - 1) / (m + 1)), (m - 1) / (m + 1), 1);
+}
+
+// Scaled by powers of two into [0.5, 1] first
+constexpr double ln(double x) {
+    return x < 0.5 ? ln(x * 2) - LOG_2 : (x > 1 ? ln(x / 2) + LOG_2 : lnReduced(x));
+}
+
+constexpr double expTaylor(double y, double term, int k) {
+    return k > 20 ? term : term + expTaylor(y, term * y / k, k + 1);
+}
+
+// Halved until |y| <= 0.5, where 20 Taylor terms are exact in double
+constexpr double exp(double y) {
+    return y < -0.5 || y > 0.5 ? square(exp(y / 2)) : expTaylor(y, 1, 1);
+}
+
+constexpr double pow(double x, double g) {
+    return x <= 0 ? 0 : (g == 1 ? x : exp(g * ln(x)));
+}
+
+/**
+ * Panel tuning of an intensity in [0, 1]: contrast around mid gray, then gamma
+ */
+constexpr double tune(double x) {
+    return pow(clamp01(0.5 + (x - 0.5) * PANEL_CONTRAST), PANEL_GAMMA);
+}
+
+constexpr uint8_t level(double x) {
+    return (uint8_t)(x * 15 + 0.5);
+}
+
+/**
+ * 8-bit gray to the nearest of the 16 levels (0, 17, ..., 255 map exactly)
+ */
+constexpr uint8_t grayToLevel(int gray) {
+    return level(gray / 255.0);
+}
+
+/**
+ * Packed frame byte (two levels) to the packed drive levels for the panel
+ */
+constexpr uint8_t panelPair(int pair) {
+    return level(tune((pair >> 4) / 15.0)) << 4 | level(tune((pair & 0x0F) / 15.0));
+}
+
+}  // namespace graylut
+
+#define GRAYLUT_4(f, i) f(i), f(i + 1), f(i + 2), f(i + 3)
+#define GRAYLUT_16(f, i) GRAYLUT_4(f, i), GRAYLUT_4(f, i + 4), GRAYLUT_4(f, i + 8), GRAYLUT_4(f, i + 12)
+#define GRAYLUT_64(f, i) GRAYLUT_16(f, i), GRAYLUT_16(f, i + 16), GRAYLUT_16(f, i + 32), GRAYLUT_16(f, i + 48)
+#define GRAYLUT_256(f) GRAYLUT_64(f, 0), GRAYLUT_64(f, 64), GRAYLUT_64(f, 128), GRAYLUT_64(f, 192)
+
+// 8-bit gray (the PNG decode canvas) to a 4bpp level
+static constexpr uint8_t GRAY_TO_LEVEL[256] = {GRAYLUT_256(graylut::grayToLevel)};
+
+// Packed frame byte to packed panel byte, PANEL_GAMMA and PANEL_CONTRAST applied;
+// the identity with the defaults
+static constexpr uint8_t PANEL_PAIR[256] = {GRAYLUT_256(graylut::panelPair)};
+
+static_assert(GRAY_TO_LEVEL[0] == 0 && GRAY_TO_LEVEL[17] == 1 && GRAY_TO_LEVEL[136] == 8 && GRAY_TO_LEVEL[255] == 15,
+              "Gray levels from the worker must map exactly");
+
+#endif // GRAYLUT_H
@@ -0,0 +1,133 @@
+#ifndef LZ4_H
+#define LZ4_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// LZ4 block decoder for the raw 4bpp and delta files written by worker.py
+// (see lz4_compress()). Templated over the byte source, anything with
+// int read(uint8_t* buf, uint32_t len) returning 0 at the end, so it builds
+// without the Arduino core for the native unit tests.
+
+/**
+ * Buffered reads for the byte-sized fields of LZ4 sequences; bulk copies
+ * bypass the buffer once it is empty
+ */
+template <class Source>
+class Lz4Reader {
+public:
+    explicit Lz4Reader(Source* source) : _source(source) {}
+
+    int next() {
+        if (_pos == _len) {
+            int n = _source->read(_buf, sizeof(_buf));
+            if (n <= 0) {
+                return -1;
+            }
+            _pos = 0;
+            _len = n;
+        }
+        return _buf[_pos++];
+    }
+
+    size_t copy(uint8_t* dst, size_t len) {
+        size_t done = len < _len - _pos ? len : _len - _pos;
+        memcpy(dst, _buf + _pos, done);
+        _pos += done;
+        while (done < len) {
+            int n = _source->read(dst + done, len - done);
+            if (n <= 0) {
+                break;
+            }
+            done += n;
+        }
+        return done;
+    }
+
+    bool drained() const { return _pos == _len; }
+
+    /**
+     * Add an LZ4 length continuation (bytes of 255 until a smaller one) to length
+     */
+    bool addLength(size_t* length) {
+        int b;
+        do {
+            b = next();
+            if (b < 0) {
+                return false;
+            }
+            *length += b;
+        } while (b == 255);
+        return true;
+    }
+
+private:
+    Source* _source;
+    uint8_t _buf[256];
+    size_t _pos = 0;
+    size_t _len = 0;
+};
+
+/**
+ * Decompress one LZ4 block into dst as its bytes arrive; matches are copied
+ * from what is already in dst, so no other window is needed
+ * Returns the bytes written (fewer than size if the input ended early), -1 if
+ * the block is corrupt
+ */
+template <class Source>
+int inflateLz4(Source* source, uint8_t* dst, size_t size) {
+    Lz4Reader<Source> in(source);
+    size_t out = 0;
+    while (true) {
+        int token = in.next();
+        if (token < 0) {
+            return out;
+        }
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !in.addLength(&literals)) {
+            return out;
+        }
+        if (literals > size - out) {
+            return -1;
+        }
+        size_t copied = in.copy(dst + out, literals);
+        out += copied;
+        if (copied < literals) {
+            return out;
+        }
+        if (out == size) {
+            // The last sequence is literals only, and ends the block
+            return in.drained() ? (int)out : -1;
+        }
+
+        int low = in.next();
+        int high = in.next();
+        if (high < 0) {
+            return out;
+        }
+        size_t offset = low | (high << 8);
+        size_t match = token & 0x0F;
+        if (match == 15 && !in.addLength(&match)) {
+            return out;
+        }
+        match += 4;
+        if (offset == 0 || offset > out || match > size - out) {
+            return -1;
+        }
+
+        const uint8_t* from = dst + out - offset;
+        if (offset >= match) {
+            memcpy(dst + out, from, match);
+        } else {
+            // Overlapping: repeats the last offset bytes (runs of a pixel pair)
+            for (size_t i = 0; i < match; i++) {
+                dst[out + i] = from[i];
+            }
+        }
+        out += match;
+    }
+}
+
+#endif // LZ4_H
@@ -1,32 +1,229 @@
 #include <Arduino.h>
-#include <M5Unified.h>
 #include <WiFi.h>
 #include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <LittleFS.h>
 #include <ArduinoJson.h>
 #include <mbedtls/md.h>
 #include <esp_wifi.h>
 #include <esp_bt.h>
+#include <freertos/event_groups.h>
 #include "config.h"
+#include "config_defaults.h"
+#include "display.h"
+#include "slideshow.h"
+#include "scheduler.h"
+#include "arena.h"
+#include "chunked.h"
+#include "decode.h"
+#include "manifest.h"
+#include "pipeline.h"
+#include "timing.h"
+
+// Same limit as worker.py's DEVICE_ID_MAX: output/<DEVICE_ID>/<timestamp>.png fits QueuedImage::path
+static_assert(sizeof(DEVICE_ID) <= 21, "DEVICE_ID is at most 20 characters");
+
+// Debug builds (env:m5papers3_debug) keep fixed delays that make the serial log
+// easy to follow; production builds spend no time waiting on anything but events
+#ifndef DEBUG_BUILD
+#define DEBUG_BUILD 0
+#endif
+#define SERIAL_ATTACH_DELAY_MS 500  // After reset, and on every wake in debug builds
+#define ADMIRE_DELAY_MS (DEBUG_BUILD ? 2000 : 0)  // After a successful display
+
+// Hosts the firmware talks to (GITHUB_API_URL in config.h points at GITHUB_API_HOST)
+#define GITHUB_API_HOST "api.github.com"
+#define GITHUB_RAW_HOST "raw.githubusercontent.com"
+
+// Base URL for files in the repository, served by raw.githubusercontent.com
+#define GITHUB_RAW_URL "https://" GITHUB_RAW_HOST "/" GITHUB_USER "/" GITHUB_REPO "/" GITHUB_BRANCH "/"
+
+// Manifest published by worker.py next to the latest image, in image/ for the
+// whole fleet and in image/<DEVICE_ID>/ for a device with its own images
+#define IMAGE_DIR "image/"
+#define MANIFEST_NAME "manifest.txt"
 
 // Storage for last displayed image filename and data
 RTC_DATA_ATTR char lastImageFilename[64] = {0};
 RTC_DATA_ATTR bool hasValidImage = false;  // Track if we have a valid image displayed
 
+// Validators of the last image listing, sent back as If-None-Match / If-Modified-Since.
+// A 304 reply skips the body and the JSON parse and, for GitHub, does not count
+// against the API rate limit.
+RTC_DATA_ATTR char listingEtag[80] = {0};
+RTC_DATA_ATTR char listingLastModified[40] = {0};
+RTC_DATA_ATTR char listingLatestFilename[64] = {0};  // Result of the listing the validators belong to
+RTC_DATA_ATTR char listingLatestSha[41] = {0};        // Git blob SHA-1 of that file
+
+// Last parsed manifest and its ETag, so an unchanged manifest costs only a 304
+RTC_DATA_ATTR ImageManifest cachedManifest = {};
+RTC_DATA_ATTR char manifestEtag[80] = {0};
+
+/**
+ * Per-host connection facts kept across deep sleep
+ */
+struct HostCache {
+    char host[32];
+    uint32_t ip;           // Last resolved address (0 = resolve via DNS)
+    uint32_t dnsMs;        // Duration of the last DNS lookup
+    uint32_t handshakeMs;  // Duration of the last full TLS connect
+};
+
+RTC_DATA_ATTR HostCache hostCache[2] = {};
+
+/**
+ * Access point and DHCP lease of the last successful connection
+ */
+struct WiFiCache {
+    bool valid;
+    uint8_t bssid[6];
+    int32_t channel;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+    uint16_t wakesSinceDhcp;  // Fast connects since the lease was last renewed via DHCP
+};
+
+RTC_DATA_ATTR WiFiCache wifiCache = {};
+
+// Set from the WiFi event task once the station has an IP address
+EventGroupHandle_t wifiEvents = nullptr;
+#define WIFI_GOT_IP_BIT BIT0
+
+// Single TLS client shared by every request: requests to the same host reuse
+// one keep-alive connection, so each wake pays for as few handshakes as possible
+WiFiClientSecure tlsClient;
+char tlsHost[32] = {0};  // Host tlsClient is currently connected to
+
+/**
+ * Copy a String into a fixed-size RTC buffer, clearing it if the value does not fit
+ */
+void storeRtcString(char* dest, size_t destSize, const String& value) {
+    if (value.length() >= destSize) {
+        dest[0] = '\0';
+        return;
+    }
+    memcpy(dest, value.c_str(), value.length() + 1);
+}
+
+/**
+ * Find the RTC cache entry for a host, recycling the first slot if it is not cached
+ */
+HostCache* getHostCache(const char* host) {
+    for (HostCache& entry : hostCache) {
+        if (strcmp(entry.host, host) == 0) {
+            return &entry;
+        }
+    }
+
+    // Not cached: shift the older entry out and start fresh in slot 0
+    hostCache[1] = hostCache[0];
+    memset(&hostCache[0], 0, sizeof(hostCache[0]));
+    strncpy(hostCache[0].host, host, sizeof(hostCache[0].host) - 1);
+    return &hostCache[0];
+}
+
+/**
+ * Make sure tlsClient is connected to host:443
+ * Reuses the open keep-alive connection when possible, and skips DNS with the
+ * address cached in RTC memory (re-resolving if that address stopped working)
+ */
+bool connectTls(const char* host) {
+    HostCache* entry = getHostCache(host);
+
+    if (tlsClient.connected() && strcmp(tlsHost, host) == 0) {
+        Serial.printf("Reusing TLS connection to %s (saved ~%u ms handshake)\n", host, entry->handshakeMs);
+        return true;
+    }
+
+    tlsClient.stop();
+    tlsHost[0] = '\0';
+
+    bool connected = false;
+    uint32_t start = millis();
+
+    if (entry->ip) {
+        connected = tlsClient.connect(IPAddress(entry->ip), 443, host, nullptr, nullptr, nullptr);
+        if (connected) {
+            Serial.printf("Connected to %s via cached address (saved ~%u ms DNS)\n", host, entry->dnsMs);
+        } else {
+            Serial.println("Cached address failed, resolving again");
+        }
+    }
+
+    if (!connected) {
+        IPAddress ip;
+        uint32_t dnsStart = millis();
+        if (!WiFi.hostByName(host, ip)) {
+            Serial.printf("DNS lookup failed: %s\n", host);
+            entry->ip = 0;
+            return false;
+        }
+        entry->ip = ip;
+        entry->dnsMs = millis() - dnsStart;
+        timingAdd(PHASE_DNS, entry->dnsMs * 1000LL);
+
+        start = millis();
+        connected = tlsClient.connect(ip, 443, host, nullptr, nullptr, nullptr);
+    }
+
+    if (!connected) {
+        Serial.printf("TLS connection to %s failed\n", host);
+        entry->ip = 0;
+        return false;
+    }
+
+    entry->handshakeMs = millis() - start;
+    timingAdd(PHASE_TLS, entry->handshakeMs * 1000LL);
+    strncpy(tlsHost, host, sizeof(tlsHost) - 1);
+    Serial.printf("TLS handshake with %s: %u ms\n", host, entry->handshakeMs);
+    return true;
+}
+
 /**
  * Get latest image filename from GitHub API
- * Returns the filename of the latest image in the image/ folder
+ * Returns the filename of the latest image in the image/ folder, and its git
+ * blob SHA-1 in blobSha
  */
-String getLatestImageFilename() {
+String getLatestImageFilename(String* blobSha) {
     HTTPClient http;
     String latestFilename = "";
+    String latestSha = "";
 
     Serial.println("\n=== Fetching image list from GitHub ===");
     Serial.printf("API URL: %s\n", GITHUB_API_URL);
 
-    http.begin(GITHUB_API_URL);
+    // HTTP/1.0 keeps GitHub from sending a chunked body, so it can be parsed from the stream
+    http.useHTTP10(true);
+    if (!connectTls(GITHUB_API_HOST)) {
+        return "";
+    }
+    http.begin(tlsClient, GITHUB_API_URL);
     http.addHeader("Accept", "application/vnd.github.v3+json");
 
+    // Conditional request: only valid if we still remember what the listing contained
+    if (listingEtag[0] && listingLatestFilename[0]) {
+        http.addHeader("If-None-Match", listingEtag);
+        if (listingLastModified[0]) {
+            http.addHeader("If-Modified-Since", listingLastModified);
+        }
+    }
+
+    const char* headerKeys[] = {"ETag", "Last-Modified", "Date"};
+    http.collectHeaders(headerKeys, 3);
+
+    int64_t requestStart = esp_timer_get_time();
     int httpCode = http.GET();
+    timingAdd(PHASE_REQUEST, esp_timer_get_time() - requestStart);
+    schedulerSetClock(http.header("Date"));
+
+    if (httpCode == HTTP_CODE_NOT_MODIFIED) {
+        http.end();
+        Serial.printf("Image list unchanged (304), latest: %s\n", listingLatestFilename);
+        *blobSha = listingLatestSha;
+        return String(listingLatestFilename);
+    }
 
     if (httpCode != HTTP_CODE_OK) {
         Serial.printf("GitHub API request failed: %d\n", httpCode);
@@ -34,36 +231,76 @@ String getLatestImageFilename() {
         return "";
     }
 
-    String payload = http.getString();
-    http.end();
+    String etag = http.header("ETag");
+    String lastModified = http.header("Last-Modified");
 
-    // Parse JSON response
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, payload);
+    // Forget old validators until the new listing has been parsed
+    listingEtag[0] = '\0';
+    listingLastModified[0] = '\0';
+    listingLatestFilename[0] = '\0';
+    listingLatestSha[0] = '\0';
 
-    if (error) {
-        Serial.printf("JSON parsing failed: %s\n", error.c_str());
-        return "";
+    // Parse the JSON array straight from the socket, one entry at a time, keeping
+    // only the fields we read: memory stays bounded however many files image/ holds
+    JsonDocument filter;
+    filter["name"] = true;
+    filter["type"] = true;
+    filter["sha"] = true;
+
+    WiFiClient& stream = http.getStream();
+    PhaseTimer parseTimer(PHASE_PARSE);
+    JsonDocument item;
+    bool parsed = stream.find("[");
+    if (!parsed) {
+        Serial.println("JSON parsing failed: listing is not an array");
     }
 
-    // Find all .png files and get the latest one (alphabetically, which matches timestamp)
-    for (JsonObject item : doc.as<JsonArray>()) {
+    while (parsed) {
+        DeserializationError error = deserializeJson(item, stream, DeserializationOption::Filter(filter));
+        if (error) {
+            Serial.printf("JSON parsing failed: %s\n", error.c_str());
+            parsed = false;
+            break;
+        }
+
         const char* name = item["name"];
         const char* type = item["type"];
+        const char* sha = item["sha"];
 
+        // Keep only .png files, tracking the latest (max alphabetically = newest timestamp)
         if (type && strcmp(type, "file") == 0 && name) {
             String filename = String(name);
             if (filename.endsWith(".png") || filename.endsWith(".PNG")) {
-                // Keep the latest (max alphabetically = newest timestamp)
                 if (filename > latestFilename) {
                     latestFilename = filename;
+                    latestSha = sha ? sha : "";
                 }
             }
         }
+
+        // Entries are separated by ',' and the array ends with ']'
+        if (!stream.findUntil(",", "]")) {
+            break;
+        }
+    }
+
+    http.end();
+
+    if (!parsed) {
+        return "";
     }
 
     if (latestFilename.length() > 0) {
         Serial.printf("Latest image found: %s\n", latestFilename.c_str());
+
+        // Remember validators so the next wake can ask "changed since?"
+        storeRtcString(listingLatestFilename, sizeof(listingLatestFilename), latestFilename);
+        storeRtcString(listingLatestSha, sizeof(listingLatestSha), latestSha);
+        *blobSha = latestSha;
+        if (listingLatestFilename[0]) {
+            storeRtcString(listingEtag, sizeof(listingEtag), etag);
+            storeRtcString(listingLastModified, sizeof(listingLastModified), lastModified);
+        }
     } else {
         Serial.println("No images found in repository");
     }
@@ -71,158 +308,914 @@ String getLatestImageFilename() {
     return latestFilename;
 }
 
+/**
+ * Fetch dir/manifest.txt from raw.githubusercontent.com
+ * Returns false if there is no usable manifest, with the HTTP status in *status
+ */
+bool fetchManifestAt(const char* dir, ImageManifest* manifest, int* status) {
+    HTTPClient http;
+    String url = String(GITHUB_RAW_URL) + dir + MANIFEST_NAME;
+    *status = 0;
+
+    Serial.println("\n=== Fetching image manifest ===");
+    Serial.printf("URL: %s\n", url.c_str());
+
+    if (!connectTls(GITHUB_RAW_HOST)) {
+        return false;
+    }
+    http.setReuse(true);  // Keep the connection open for the image download
+    http.begin(tlsClient, url);
+
+    // The ETag is only good for the manifest it came with
+    if (manifestEtag[0] && cachedManifest.latest[0] && strcmp(cachedManifest.dir, dir) == 0) {
+        http.addHeader("If-None-Match", manifestEtag);
+    }
+
+    const char* headerKeys[] = {"ETag", "Date"};
+    http.collectHeaders(headerKeys, 2);
+
+    int64_t requestStart = esp_timer_get_time();
+    int httpCode = http.GET();
+    timingAdd(PHASE_REQUEST, esp_timer_get_time() - requestStart);
+    schedulerSetClock(http.header("Date"));
+    *status = httpCode;
+
+    if (httpCode == HTTP_CODE_NOT_MODIFIED) {
+        http.end();
+        *manifest = cachedManifest;
+        Serial.printf("Manifest unchanged (304), latest: %s\n", manifest->latest);
+        return true;
+    }
+
+    if (httpCode != HTTP_CODE_OK) {
+        Serial.printf("Manifest request failed: %d\n", httpCode);
+        http.end();
+        return false;
+    }
+
+    if (http.getSize() > MANIFEST_MAX_SIZE) {
+        Serial.printf("Manifest too large: %d bytes\n", http.getSize());
+        http.end();
+        return false;
+    }
+
+    String etag = http.header("ETag");
+    String body = http.getString();
+    http.end();
+
+    manifestEtag[0] = '\0';
+    memset(&cachedManifest, 0, sizeof(cachedManifest));
+
+    int64_t parseStart = esp_timer_get_time();
+    bool valid = parseManifest(body.c_str(), body.length(), manifest);
+    timingAdd(PHASE_PARSE, esp_timer_get_time() - parseStart);
+
+    if (!valid) {
+        Serial.println("Invalid manifest");
+        return false;
+    }
+
+    storeRtcString(manifest->dir, sizeof(manifest->dir), dir);
+    cachedManifest = *manifest;
+    storeRtcString(manifestEtag, sizeof(manifestEtag), etag);
+
+    Serial.printf("Latest image: %s (%u bytes)\n", manifest->latest, manifest->size);
+    return true;
+}
+
+/**
+ * Find the latest image: this device's own manifest when it has one, the
+ * shared manifest otherwise
+ * Returns false if there is no usable manifest: the caller falls back to the GitHub
+ * API unless deviceFailed is set (this device's own manifest exists but failed)
+ */
+bool fetchManifest(ImageManifest* manifest, bool* deviceFailed) {
+    int status;
+    *deviceFailed = false;
+    if (DEVICE_ID[0]) {
+        // Anything but "not published" means the device has its own images:
+        // never show the shared ones instead just because a request failed
+        if (fetchManifestAt(IMAGE_DIR DEVICE_ID "/", manifest, &status)) {
+            return true;
+        }
+        if (status != HTTP_CODE_NOT_FOUND) {
+            *deviceFailed = true;
+            return false;
+        }
+        Serial.println("No images for device " DEVICE_ID ", using the shared manifest");
+    }
+    return fetchManifestAt(IMAGE_DIR, manifest, &status);
+}
+
+void onWiFiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        xEventGroupSetBits(wifiEvents, WIFI_GOT_IP_BIT);
+    }
+}
+
+/**
+ * Block until the station has an IP address or the timeout expires
+ */
+bool waitForWiFi(uint32_t timeoutMs) {
+    EventBits_t bits = xEventGroupWaitBits(wifiEvents, WIFI_GOT_IP_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(timeoutMs));
+    return (bits & WIFI_GOT_IP_BIT) && WiFi.status() == WL_CONNECTED;
+}
+
 /**
  * Connect to WiFi
+ * Warm path: directed connect to the cached BSSID/channel with the cached lease
+ * as static IP (no scan, no DHCP). Falls back to a full scan + DHCP if that fails,
+ * and periodically renews the lease the normal way.
  */
 bool connectWiFi() {
     Serial.println("\n=== Connecting to WiFi ===");
     Serial.printf("SSID: %s\n", WIFI_SSID);
 
+    uint32_t start = millis();
+
+    if (!wifiEvents) {
+        wifiEvents = xEventGroupCreate();
+        WiFi.onEvent(onWiFiEvent, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    }
+    xEventGroupClearBits(wifiEvents, WIFI_GOT_IP_BIT);
+
+    WiFi.persistent(false);  // Credentials come from config.h, don't rewrite them to flash
     WiFi.mode(WIFI_STA);
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
 
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 30) {
-        delay(500);
-        Serial.print(".");
-        attempts++;
+    bool connected = false;
+    bool fastPath = wifiCache.valid && wifiCache.wakesSinceDhcp < WIFI_DHCP_REFRESH_WAKES;
+
+    if (fastPath) {
+        WiFi.config(IPAddress(wifiCache.ip), IPAddress(wifiCache.gateway),
+                    IPAddress(wifiCache.subnet), IPAddress(wifiCache.dns));
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD, wifiCache.channel, wifiCache.bssid);
+
+        connected = waitForWiFi(WIFI_FAST_CONNECT_TIMEOUT_MS);
+        if (connected) {
+            wifiCache.wakesSinceDhcp++;
+        } else {
+            fastPath = false;
+            Serial.println("Fast connect failed, falling back to full scan + DHCP");
+            wifiCache.valid = false;
+            WiFi.disconnect();
+            xEventGroupClearBits(wifiEvents, WIFI_GOT_IP_BIT);
+        }
     }
 
-    if (WiFi.status() == WL_CONNECTED) {
-        Serial.println("\nWiFi connected!");
+    if (!connected) {
+        WiFi.config(IPAddress(), IPAddress(), IPAddress());  // All zero = use DHCP
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+
+        connected = waitForWiFi(WIFI_CONNECT_TIMEOUT_MS);
+        if (connected) {
+            // Remember AP and lease for the next wakes
+            memcpy(wifiCache.bssid, WiFi.BSSID(), sizeof(wifiCache.bssid));
+            wifiCache.channel = WiFi.channel();
+            wifiCache.ip = WiFi.localIP();
+            wifiCache.gateway = WiFi.gatewayIP();
+            wifiCache.subnet = WiFi.subnetMask();
+            wifiCache.dns = WiFi.dnsIP(0);
+            wifiCache.wakesSinceDhcp = 0;
+            wifiCache.valid = true;
+        }
+    }
+
+    if (connected) {
+        // Modem sleep has the AP hold frames until the next beacon, which throttles
+        // bulk downloads; the radio is switched off altogether once they are done
+        WiFi.setSleep(false);
+        Serial.printf("WiFi connected in %lu ms (%s)\n", millis() - start, fastPath ? "cached AP, static IP" : "scan + DHCP");
         Serial.printf("IP: %s\n", WiFi.localIP().toString().c_str());
         return true;
     } else {
-        Serial.println("\nWiFi connection failed!");
+        Serial.println("WiFi connection failed!");
         return false;
     }
 }
 
+// Reconnect when no data arrives for this long
+#define STREAM_TIMEOUT_MS 5000
+
+// Reconnects per download (each resuming with a Range request) before giving up until the next wake
+#define DOWNLOAD_RETRIES 3
+
+// Flash file holding the bytes received so far of an interrupted download
+#define STAGING_PATH "/staging.bin"
+
+// Flash file holding the latest image shown, the base for the next delta
+// (the slideshow's slots serve instead when it is enabled)
+#define BASE_PATH "/base.raw4"
+
+// Largest image accepted (also the limit while a chunked body's length is unknown)
+#define IMAGE_MAX_SIZE (1024 * 1024)
+
 /**
- * Download image from URL and return data
+ * Download being staged in flash, kept across deep sleep
  */
-uint8_t* downloadImage(const String& filename, size_t* imageSize) {
-    HTTPClient http;
+struct DownloadState {
+    char name[64];    // Repository path being downloaded (timestamped names never change content)
+    uint32_t size;    // Total size in bytes
+    uint32_t staged;  // Bytes already written to STAGING_PATH
+};
+
+RTC_DATA_ATTR DownloadState downloadState = {};
+RTC_DATA_ATTR char baseImageFilename[64] = {0};  // Image held in BASE_PATH
+
+/**
+ * Mount LittleFS for the staging file and the slideshow cache
+ * (formats the partition on first use)
+ */
+bool mountFlash() {
+    static bool mounted = false;
+    static bool attempted = false;
+    if (!attempted) {
+        attempted = true;
+        mounted = LittleFS.begin(true);
+        if (!mounted) {
+            Serial.println("LittleFS mount failed, downloads will not be resumable or cached");
+        }
+    }
+    return mounted;
+}
+
+/**
+ * The arena's network receive buffer, taken on first use
+ */
+static uint8_t* receiveBuffer() {
+    static uint8_t* buffer = (uint8_t*)arenaAlloc(ARENA_NET, ARENA_NET_SIZE);
+    return buffer;
+}
+
+/**
+ * Byte source that feeds the decoder straight from the HTTP body, so the decode
+ * overlaps with the download and the file never has to fit in RAM.
+ * Received bytes are also appended to a staging file in flash: when the
+ * connection stalls it reconnects and continues with "Range: bytes=N-", and a
+ * download interrupted for good is resumed the same way on the next wake,
+ * replaying the staged bytes to the decoder first.
+ * The network is read in blocks of up to ARENA_NET_SIZE, straight into the
+ * caller's buffer for large reads and through the receive buffer for small ones.
+ */
+class ImageDownload : public ImageSource {
+public:
+    /**
+     * Request a file (path in the repository) and validate the response headers
+     * expectedSize comes from the manifest (0 = unknown)
+     */
+    bool open(const String& path, size_t expectedSize);
+
+    int read(uint8_t* buf, uint32_t len) override;
+
+    void skip(int32_t offset) override {
+        uint8_t scratch[64];
+        while (offset > 0) {
+            int n = read(scratch, min((int32_t)sizeof(scratch), offset));
+            if (n <= 0) {
+                return;
+            }
+            offset -= n;
+        }
+    }
+
+    bool seek(uint32_t offset) override {
+        // Forward only: the socket cannot rewind
+        if (offset < _pos) {
+            return false;
+        }
+        skip(offset - _pos);
+        return _pos == offset;
+    }
+
+    void close() override {}
+
+    int32_t tell() override { return _pos; }
+
+    /**
+     * Release the connection; once every byte was consumed the staging file is
+     * renamed to keepAs when given (returns whether that worked) and dropped
+     * otherwise, while an incomplete download is kept for the next wake
+     */
+    bool finish(const char* keepAs = nullptr);
+
+    /**
+     * Hash the content while it streams in, to check it against a published
+     * digest: hex SHA-256, or with gitBlob the git blob SHA-1 the GitHub API lists
+     * Call after open(), before reading; an empty digest disables the check
+     */
+    void expectDigest(const char* hex, bool gitBlob = false);
+
+    /**
+     * True once every byte arrived and matched the expected digest (if any)
+     */
+    bool verified();
+
+    void readToEnd() override {
+        uint8_t scratch[64];
+        while (!_sized && read(scratch, sizeof(scratch)) > 0) {
+        }
+    }
+
+    size_t received() const override { return _pos; }
+    size_t size() const override { return _size; }
+
+    ~ImageDownload() {
+        if (_hashing) {
+            mbedtls_md_free(&_md);
+        }
+    }
 
+private:
+    int get(size_t offset);
+    bool reconnect(size_t offset);
+    int readNetwork(uint8_t* buf, size_t len);
+    int readChunkFraming();
+    void deliver(const uint8_t* buf, size_t len);
+    void stopStaging();
+
+    String _url;
+    HTTPClient _http;
+    WiFiClient* _stream = nullptr;
+    File _staging;       // Reader over the staged prefix, then appender
+    bool _appending = false;
+    size_t _prefix = 0;  // Bytes replayed from flash before the network
+    size_t _size = 0;
+    size_t _pos = 0;
+    int _retries = 0;
+    bool _sized = true;       // Length known up front, else set by the last chunk
+    bool _chunked = false;    // Chunked transfer encoding
+    ChunkedFraming _framing;
+    uint8_t* _rx = nullptr;   // Bulk receive buffer for small reads
+    size_t _rxPos = 0;
+    size_t _rxLen = 0;
+    size_t _netBytes = 0;     // Throughput: bytes from the network, first and last arrival
+    int64_t _netStart = 0;
+    int64_t _netEnd = 0;
+    mbedtls_md_context_t _md;
+    bool _hashing = false;
+    char _expected[65] = {0};
+    int _verdict = -1;  // -1 = not checked yet, else 0/1
+};
+
+int ImageDownload::get(size_t offset) {
+    if (!connectTls(GITHUB_RAW_HOST)) {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    _http.setReuse(true);
+    _http.begin(tlsClient, _url);
+    if (offset) {
+        _http.addHeader("Range", String("bytes=") + offset + "-");
+    }
+    const char* headerKeys[] = {"Transfer-Encoding"};
+    _http.collectHeaders(headerKeys, 1);
+
+    PhaseTimer timer(PHASE_DOWNLOAD);
+    int httpCode = _http.GET();
+
+    // HTTPClient hands over the raw body: chunk framing is parsed here
+    String encoding = _http.header("Transfer-Encoding");
+    encoding.toLowerCase();
+    _chunked = encoding.indexOf("chunked") >= 0;
+    _framing.reset();
+    _rxPos = _rxLen = 0;
+    return httpCode;
+}
+
+bool ImageDownload::open(const String& path, size_t expectedSize) {
     // Construct GitHub raw URL
-    String imageUrl = "https://raw.githubusercontent.com/";
-    imageUrl += GITHUB_USER;
-    imageUrl += "/";
-    imageUrl += GITHUB_REPO;
-    imageUrl += "/";
-    imageUrl += GITHUB_BRANCH;
-    imageUrl += "/image/";
-    imageUrl += filename;
+    _url = GITHUB_RAW_URL;
+    _url += path;
+    _rx = receiveBuffer();
 
     Serial.println("\n=== Downloading Image ===");
-    Serial.printf("URL: %s\n", imageUrl.c_str());
+    Serial.printf("URL: %s\n", _url.c_str());
 
-    http.begin(imageUrl);
-    int httpCode = http.GET();
+    // Anything staged for this file? Only trust it if flash and RTC agree
+    size_t staged = 0;
+    if (mountFlash() && strcmp(downloadState.name, path.c_str()) == 0 && downloadState.staged &&
+        (!expectedSize || downloadState.size == expectedSize)) {
+        File f = LittleFS.open(STAGING_PATH, "r");
+        if (f && f.size() == downloadState.staged && downloadState.staged < downloadState.size) {
+            staged = downloadState.staged;
+            _size = downloadState.size;
+        }
+        f.close();
+    }
 
-    if (httpCode != HTTP_CODE_OK) {
+    int httpCode = get(staged);
+    int contentLength = _http.getSize();
+    bool resumable = httpCode == HTTP_CODE_PARTIAL_CONTENT &&
+                     (contentLength == (int)(_size - staged) || (contentLength < 0 && _chunked));
+
+    if (staged && !resumable && httpCode != HTTP_CODE_OK) {
+        // The staged prefix cannot be resumed (416, wrong range, error...): drop it, or
+        // every later wake would retry the same request; one plain download instead
+        Serial.printf("Resume failed: %d, restarting download\n", httpCode);
+        _http.end();
+        tlsClient.stop();  // The unread reply body would be taken for the next response
+        stopStaging();
+        staged = 0;
+        httpCode = get(0);
+        contentLength = _http.getSize();
+    }
+
+    if (staged && resumable) {
+        Serial.printf("Resuming download at %u/%u bytes\n", staged, _size);
+        _prefix = staged;
+    } else if (httpCode == HTTP_CODE_OK) {
+        if (staged) {
+            Serial.println("Server ignored Range, restarting download");
+        }
+
+        if (contentLength < 0 && _chunked) {
+            // The manifest's size if there is one, else the last chunk says when it is done
+            Serial.println("No Content-Length, reading chunked transfer encoding");
+            contentLength = expectedSize;
+        } else {
+            Serial.printf("Image size: %d bytes\n", contentLength);
+        }
+        _sized = contentLength > 0;
+
+        if ((!_sized && !_chunked) || contentLength > IMAGE_MAX_SIZE) {
+            Serial.println("Invalid image size");
+            _http.end();
+            return false;
+        }
+
+        if (_sized && expectedSize && (size_t)contentLength != expectedSize) {
+            Serial.printf("Size mismatch: manifest says %d bytes\n", expectedSize);
+            _http.end();
+            return false;
+        }
+
+        _size = _sized ? contentLength : IMAGE_MAX_SIZE;
+        _prefix = 0;
+    } else {
         Serial.printf("HTTP GET failed: %d\n", httpCode);
-        http.end();
-        return nullptr;
+        _http.end();
+        return false;
     }
 
-    *imageSize = http.getSize();
-    Serial.printf("Image size: %d bytes\n", *imageSize);
+    _stream = _http.getStreamPtr();
+    _netStart = _netEnd = esp_timer_get_time();
 
-    if (*imageSize <= 0 || *imageSize > 1024 * 1024) {  // Max 1MB
-        Serial.println("Invalid image size");
-        http.end();
-        return nullptr;
+    // Replay the staged prefix, or start a new staging file
+    if (_prefix) {
+        _staging = LittleFS.open(STAGING_PATH, "r");
+    } else if (mountFlash()) {
+        _staging = LittleFS.open(STAGING_PATH, "w");
+        _appending = true;
+        memset(&downloadState, 0, sizeof(downloadState));
+        strncpy(downloadState.name, path.c_str(), sizeof(downloadState.name) - 1);
+        downloadState.size = _sized ? _size : 0;  // Not resumable until the length is known
     }
 
-    // Allocate memory for image
-    uint8_t* imageData = (uint8_t*)malloc(*imageSize);
-    if (!imageData) {
-        Serial.println("Failed to allocate memory for image");
-        http.end();
-        return nullptr;
-    }
-
-    // Read image data
-    WiFiClient* stream = http.getStreamPtr();
-    size_t bytesRead = 0;
-    while (http.connected() && bytesRead < *imageSize) {
-        size_t available = stream->available();
-        if (available) {
-            size_t toRead = min(available, *imageSize - bytesRead);
-            stream->readBytes(imageData + bytesRead, toRead);
-            bytesRead += toRead;
+    return true;
+}
+
+bool ImageDownload::reconnect(size_t offset) {
+    _retries++;
+    Serial.printf("Connection stalled at %u/%u bytes, resuming (attempt %d/%d)\n",
+                  offset, _size, _retries, DOWNLOAD_RETRIES);
+
+    _http.end();
+    tlsClient.stop();
+    _stream = nullptr;
+
+    int httpCode = get(offset);
+    int contentLength = _http.getSize();
+    if (httpCode != HTTP_CODE_PARTIAL_CONTENT ||
+        !(contentLength == (int)(_size - offset) || (contentLength < 0 && _chunked) || (!_sized && contentLength > 0))) {
+        Serial.printf("Resume failed: %d\n", httpCode);
+        return false;
+    }
+    if (!_sized && contentLength > 0) {
+        _size = offset + contentLength;
+        _sized = true;
+    }
+
+    _stream = _http.getStreamPtr();
+    return true;
+}
+
+int ImageDownload::readChunkFraming() {
+    int c = _stream->read();
+    if (c < 0) {
+        return 0;
+    }
+    if (!_framing.feed(c)) {
+        Serial.printf("Malformed chunk header: %s\n", _framing.line());
+        return -1;
+    }
+    return 1;
+}
+
+int ImageDownload::readNetwork(uint8_t* buf, size_t len) {
+    // Fill the whole block, waiting while the socket is empty: only a stall or
+    // the end of the body returns less
+    size_t got = 0;
+    uint32_t lastData = millis();
+    while (got < len && !_framing.done()) {
+        int n = 0;
+        if (_stream && _chunked && _framing.left() == 0) {
+            n = readChunkFraming();
+            if (n < 0) {
+                _stream = nullptr;  // Out of sync with the framing: reconnect where the data ends
+            }
+        } else if (_stream) {
+            n = _stream->read(buf + got, _chunked ? min(len - got, _framing.left()) : len - got);
+            if (n > 0) {
+                got += n;
+                if (_chunked) {
+                    _framing.consume(n);
+                }
+            }
+        }
+        if (n > 0) {
+            lastData = millis();
+            continue;
+        }
+
+        if (_stream && _stream->connected() && millis() - lastData <= STREAM_TIMEOUT_MS) {
+            delay(1);  // Blocks this task for a tick: the CPU idles until lwIP has more data
+            continue;
+        }
+        if (got) {
+            break;  // Hand over what arrived; the next read reconnects
+        }
+        if (_retries >= DOWNLOAD_RETRIES || !reconnect(_pos)) {
+            return 0;
+        }
+        lastData = millis();
+    }
+
+    if (got) {
+        _netBytes += got;
+        _netEnd = esp_timer_get_time();
+    }
+    if (_framing.done() && !_sized) {
+        // Last chunk: now the length is known
+        _size = _pos + got;
+        _sized = true;
+        downloadState.size = _size;
+    }
+    return got;
+}
+
+void ImageDownload::deliver(const uint8_t* buf, size_t len) {
+    _pos += len;
+    if (_hashing) {
+        mbedtls_md_update(&_md, buf, len);
+    }
+
+    if (_appending && _staging) {
+        if (_staging.write(buf, len) == len) {
+            downloadState.staged = _pos;
         } else {
-            delay(10);
+            Serial.println("Staging write failed, download will not be resumable");
+            stopStaging();
         }
     }
+}
 
-    http.end();
+int ImageDownload::read(uint8_t* buf, uint32_t len) {
+    size_t want = min((size_t)len, _size - _pos);
+    if (want == 0) {
+        return 0;
+    }
 
-    if (bytesRead != *imageSize) {
-        Serial.printf("Download incomplete: %d/%d bytes\n", bytesRead, *imageSize);
-        free(imageData);
-        return nullptr;
+    // Staged bytes from an earlier attempt come first
+    if (_pos < _prefix) {
+        int n = _staging.read(buf, min(want, _prefix - _pos));
+        if (n <= 0) {
+            Serial.println("Failed to read staged download");
+            return 0;
+        }
+        _pos += n;
+        if (_hashing) {
+            mbedtls_md_update(&_md, buf, n);
+        }
+        if (_pos == _prefix) {
+            // Prefix replayed: new bytes get appended from here on
+            _staging.close();
+            _staging = LittleFS.open(STAGING_PATH, "a");
+            _appending = true;
+        }
+        return n;
+    }
+
+    // Large reads go straight into the caller's buffer, small ones are served
+    // from a bulk read into the receive buffer
+    if (_rxPos == _rxLen) {
+        bool direct = !_rx || want >= ARENA_NET_SIZE;
+        int64_t readStart = esp_timer_get_time();
+        int n = readNetwork(direct ? buf : _rx, min(direct ? want : _size - _pos, (size_t)ARENA_NET_SIZE));
+        timingAdd(PHASE_DOWNLOAD, esp_timer_get_time() - readStart);
+        if (n <= 0) {
+            return 0;
+        }
+        if (direct) {
+            deliver(buf, n);
+            return n;
+        }
+        _rxPos = 0;
+        _rxLen = n;
     }
 
-    Serial.println("Download complete!");
-    return imageData;
+    size_t n = min(want, _rxLen - _rxPos);
+    memcpy(buf, _rx + _rxPos, n);
+    _rxPos += n;
+    deliver(buf, n);
+    return n;
 }
 
-/**
- * Display image on M5PaperS3 (only refresh if changed)
- */
-bool displayImage(const uint8_t* imageData, size_t imageSize) {
-    Serial.println("\n=== Displaying Image ===");
+void ImageDownload::expectDigest(const char* hex, bool gitBlob) {
+    size_t hexLen = gitBlob ? 40 : 64;
+    if (!hex || strlen(hex) != hexLen || _pos != 0 || (gitBlob && !_sized)) {
+        return;
+    }
 
-    M5.Display.setRotation(DISPLAY_ROTATION);
+    // mbedtls uses the S3's SHA accelerator
+    mbedtls_md_init(&_md);
+    if (mbedtls_md_setup(&_md, mbedtls_md_info_from_type(gitBlob ? MBEDTLS_MD_SHA1 : MBEDTLS_MD_SHA256), 0) != 0 ||
+        mbedtls_md_starts(&_md) != 0) {
+        mbedtls_md_free(&_md);
+        return;
+    }
+    _hashing = true;
+    strcpy(_expected, hex);
 
-    // Clear only once before drawing new image
-    M5.Display.clearDisplay();
+    if (gitBlob) {
+        // Git hashes "blob <size>\0" followed by the content
+        char header[24];
+        int len = snprintf(header, sizeof(header), "blob %u", (unsigned)_size);
+        mbedtls_md_update(&_md, (const uint8_t*)header, len + 1);
+    }
+}
 
-    // Draw PNG directly to display buffer (no refresh yet)
-    bool success = M5.Display.drawPng(imageData, imageSize, 0, 0, IMAGE_WIDTH, IMAGE_HEIGHT);
+bool ImageDownload::verified() {
+    readToEnd();
+    if (!complete()) {
+        return false;
+    }
+    if (!_hashing) {
+        return true;
+    }
 
-    if (success) {
-        // Single refresh after image is drawn
-        M5.Display.display();
-        Serial.println("Image displayed successfully!");
-    } else {
+    if (_verdict < 0) {
+        uint8_t digest[32];
+        char hex[65];
+        size_t digestLen = strlen(_expected) / 2;
+        mbedtls_md_finish(&_md, digest);
+        for (size_t i = 0; i < digestLen; i++) {
+            sprintf(hex + i * 2, "%02x", digest[i]);
+        }
+        _verdict = strcasecmp(hex, _expected) == 0;
+        Serial.printf(_verdict ? "Checksum verified (%s)\n" : "Checksum mismatch: got %s\n", hex);
+    }
+    return _verdict;
+}
+
+void ImageDownload::stopStaging() {
+    _staging.close();
+    _appending = false;
+    LittleFS.remove(STAGING_PATH);
+    memset(&downloadState, 0, sizeof(downloadState));
+}
+
+bool ImageDownload::finish(const char* keepAs) {
+    _http.end();
+    _stream = nullptr;
+
+    if (_netBytes) {
+        int64_t us = max(_netEnd - _netStart, (int64_t)1);
+        Serial.printf("Received %u bytes in %lld ms: %llu KB/s (%s)\n", (unsigned)_netBytes, us / 1000,
+                      (uint64_t)_netBytes * 1000000ULL / us / 1024, _chunked ? "chunked" : "Content-Length");
+    }
+
+    if (complete()) {
+        // Every byte made it to flash unless staging was given up on the way
+        bool kept = false;
+        if (keepAs && _appending && downloadState.staged == _size && verified()) {
+            _staging.close();
+            LittleFS.remove(keepAs);
+            kept = LittleFS.rename(STAGING_PATH, keepAs);
+        }
+        stopStaging();
+        return kept;
+    }
+
+    if (_staging) {
+        _staging.close();
+        if (downloadState.staged) {
+            Serial.printf("Download interrupted, %u/%u bytes staged for the next wake\n",
+                          downloadState.staged, downloadState.size);
+        }
+    }
+    return false;
+}
+
+/**
+ * Push the decoded frame to the panel
+ * Call with the radio off: the refresh is the longest, hungriest phase of a wake
+ */
+bool presentImage() {
+    Serial.println("\n=== Displaying Image ===");
+    if (!displayPresent()) {
         Serial.println("Failed to display image");
+        return false;
     }
+    Serial.println("Image displayed successfully!");
+    return true;
+}
 
-    return success;
+/**
+ * Close connections and power the radio down (safe to call more than once)
+ */
+void stopWiFi() {
+    tlsClient.stop();
+    tlsHost[0] = '\0';
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+    esp_wifi_stop();
 }
 
 /**
- * Enter deep sleep with maximum power savings
+ * Fixed delay, accounted as waiting time
+ */
+void waitMs(uint32_t ms) {
+    if (ms == 0) {
+        return;
+    }
+    PhaseTimer timer(PHASE_WAIT);
+    delay(ms);
+}
+
+/**
+ * Enter deep sleep with maximum power savings, for as long as the scheduler says
  */
 void enterDeepSleep() {
     Serial.println("\n=== Entering Deep Sleep ===");
-    Serial.printf("Sleep duration: %llu minutes\n", SLEEP_DURATION_US / 60000000ULL);
+    uint64_t sleepUs = schedulerSleepUs();
+    Serial.printf("Sleep duration: %llu minutes\n", sleepUs / 60000000ULL);
+    timingFinish();
+    arenaReport();
     Serial.flush();  // Ensure serial output completes
 
     // Shutdown WiFi completely
-    WiFi.disconnect(true);
-    WiFi.mode(WIFI_OFF);
-    esp_wifi_stop();
+    stopWiFi();
 
     // Disable Bluetooth
     esp_bt_controller_disable();
 
     // Power down peripherals
-    M5.Display.sleep();  // E-paper display to sleep mode
+    displaySleep();  // E-paper panel power off
 
     // Disable all wakeup sources except timer
     esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
 
     // Configure timer wakeup
-    esp_sleep_enable_timer_wakeup(SLEEP_DURATION_US);
+    esp_sleep_enable_timer_wakeup(sleepUs);
 
     // Enter deep sleep (RTC memory preserved, minimal power)
     esp_deep_sleep_start();
 }
 
+/**
+ * Remember what is on the panel now
+ */
+void markDisplayed(const char* name) {
+    strncpy(lastImageFilename, name, sizeof(lastImageFilename) - 1);
+    lastImageFilename[sizeof(lastImageFilename) - 1] = '\0';
+    hasValidImage = true;
+    Serial.printf("Successfully updated to: %s\n", lastImageFilename);
+}
+
+/**
+ * Image name (as in lastImageFilename) of a repository path: the file name,
+ * with a raw copy standing for its PNG
+ */
+String imageNameOf(const char* path) {
+    String name = path;
+    int slash = name.lastIndexOf('/');
+    if (slash >= 0) {
+        name = name.substring(slash + 1);
+    }
+    if (name.endsWith(".raw4")) {
+        name = name.substring(0, name.length() - 5) + ".png";
+    }
+    return name;
+}
+
+/**
+ * Display an image cached in flash; one that fails to decode is dropped
+ * The radio must already be off
+ */
+bool showSlide(const Slide* slide) {
+    Serial.printf("\n=== Showing cached image: %s ===\n", slide->name);
+
+    FileImageSource source;
+    bool decoded = source.open(slideshowPath(slide)) && source.size() == slide->size &&
+                   (slide->raw ? decodeRawImage(&source) : decodeImage(&source));
+    source.close();
+
+    if (!decoded) {
+        Serial.println("Cached image unusable, dropping it");
+        slideshowRemove(slide->name);
+        return false;
+    }
+
+    if (!presentImage()) {
+        return false;
+    }
+
+    markDisplayed(slide->name);
+    schedulerSlideShown();
+    return true;
+}
+
+/**
+ * Download an image into a free slideshow slot without displaying it
+ */
+bool prefetchImage(const char* path, size_t expectedSize, const char* sha256) {
+    int slot = slideshowFreeSlot();
+    if (slot < 0) {
+        return false;
+    }
+
+    ImageDownload download;
+    if (!download.open(path, expectedSize)) {
+        return false;
+    }
+    download.expectDigest(sha256);
+
+    uint8_t buf[1024];
+    while (download.read(buf, sizeof(buf)) > 0) {
+    }
+
+    if (!download.finish(slideshowSlotPath(slot).c_str())) {
+        Serial.printf("Failed to cache %s\n", path);
+        return false;
+    }
+
+    String name = imageNameOf(path);
+    slideshowStore(slot, name.c_str(), String(path).endsWith(".raw4"), download.size());
+    Serial.printf("Cached %s for the slideshow\n", name.c_str());
+    return true;
+}
+
+/**
+ * Decode the image a delta applies to into the frame: from the slideshow cache,
+ * or from BASE_PATH when that holds it
+ */
+bool loadDeltaBase(const char* name) {
+    const Slide* slide = slideshowFind(name);
+    if (!slide && (strcmp(name, baseImageFilename) != 0 || !mountFlash())) {
+        return false;
+    }
+
+    FileImageSource source;
+    bool decoded = source.open(slide ? slideshowPath(slide) : String(BASE_PATH)) &&
+                   (slide && !slide->raw ? decodeImage(&source) : decodeRawImage(&source));
+    source.close();
+    return decoded;
+}
+
+/**
+ * Build the latest image in the frame from the image it was published after
+ * plus the delta of the tiles that changed, instead of downloading all of it
+ */
+bool fetchDelta(const ImageManifest& manifest) {
+    if (!manifest.delta[0] || !loadDeltaBase(manifest.deltaBase)) {
+        return false;
+    }
+
+    ImageDownload deltaStream;
+    if (!deltaStream.open(String(manifest.dir) + manifest.delta, manifest.deltaSize)) {
+        return false;
+    }
+    deltaStream.expectDigest(manifest.deltaSha256);
+    PipelinedSource pipe(&deltaStream);
+    bool applied = decodeDelta(pipe.start() ? (ImageSource*)&pipe : &deltaStream, manifest.deltaBase);
+    pipe.stop();
+    applied = applied && deltaStream.verified();
+    deltaStream.finish(nullptr);
+
+    if (!applied) {
+        Serial.println("Delta not applied, downloading the full image");
+    }
+    return applied;
+}
+
+/**
+ * Keep the frame in BASE_PATH as the base for the next delta
+ */
+void saveDeltaBase(const char* name) {
+    baseImageFilename[0] = '\0';
+    if (mountFlash() && saveRawImage(BASE_PATH)) {
+        strncpy(baseImageFilename, name, sizeof(baseImageFilename) - 1);
+    }
+}
+
 /**
  * Show temporary error message (2 seconds) then restore previous image
  */
@@ -236,82 +1229,213 @@ void showTemporaryError(const char* message) {
         // No need to do anything - just return
     } else {
         // First boot, no previous image - show full error screen
-        M5.Display.clearDisplay();
-        M5.Display.setRotation(DISPLAY_ROTATION);
-        M5.Display.setTextSize(3);
-        M5.Display.setTextColor(TFT_BLACK);
-        M5.Display.drawString("Error:", 20, 100);
-        M5.Display.setTextSize(2);
-        M5.Display.drawString(message, 20, 150);
-        M5.Display.display();
+        if (displayDrawError(message)) {
+            stopWiFi();
+            displayPresent();
+        }
     }
 }
 
 void setup() {
-    // Configure M5 with minimal power consumption
-    auto cfg = M5.config();
-    cfg.output_power = false;  // Disable external power output
-    M5.begin(cfg);
-
-    // Disable unnecessary peripherals
-    M5.In_I2C.release();  // Release I2C if not needed
+    // The timer starts with the app: this is how long the boot took
+    timingAdd(PHASE_BOOT, esp_timer_get_time());
 
+    // The e-paper panel is only powered up (by FastEPD) when something is shown
     Serial.begin(115200);
-    delay(500);  // Reduced delay
+    if (DEBUG_BUILD || esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER) {
+        // Give a serial monitor time to attach after reset or flashing
+        waitMs(SERIAL_ATTACH_DELAY_MS);
+    } else {
+        // Log output must not hold up a wake: drop it when no USB host is reading
+        Serial.setTxTimeoutMs(0);
+    }
     Serial.println("\n=== M5PaperS3 Image Display ===");
-    Serial.printf("Display: %dx%d\n", M5.Display.width(), M5.Display.height());
+    Serial.printf("Display: %dx%d\n", IMAGE_WIDTH, IMAGE_HEIGHT);
     Serial.printf("Last displayed image: %s\n", lastImageFilename[0] ? lastImageFilename : "none");
     Serial.printf("Has valid image: %s\n", hasValidImage ? "yes" : "no");
 
+    // Nearly flat battery: neither radio nor panel, straight back to sleep (for longer)
+    if (!schedulerCheckBattery()) {
+        Serial.println("Battery critically low, skipping this wake");
+        enterDeepSleep();
+        return;
+    }
+
+    // Every large buffer of the wake comes from one PSRAM block, allocated up front
+    arenaInit();
+
+    // Between queue refreshes, show the next cached image without powering up the radio
+    if (SLIDESHOW_SIZE > 1 && !slideshowSyncDue() && mountFlash()) {
+        slideshowOfflineWake();
+        const Slide* slide = slideshowNext(lastImageFilename);
+        if (slide && showSlide(slide)) {
+            waitMs(ADMIRE_DELAY_MS);
+            enterDeepSleep();
+            return;
+        }
+        Serial.println("Nothing cached to show, going online");
+    }
+
     // Connect to WiFi
-    if (!connectWiFi()) {
+    int64_t wifiStart = esp_timer_get_time();
+    bool wifiConnected = connectWiFi();
+    timingAdd(PHASE_WIFI, esp_timer_get_time() - wifiStart);
+    if (!wifiConnected) {
         showTemporaryError("WiFi failed");
         enterDeepSleep();
         return;
     }
 
-    // Get latest image filename from GitHub
-    String latestFilename = getLatestImageFilename();
+    // Same behaviour as the GitHub API default client: TLS without certificate checks
+    tlsClient.setInsecure();
 
-    if (latestFilename.length() == 0) {
-        showTemporaryError("No images in repo");
+    // Find the latest image: the manifest is one small file on the same host as the
+    // image, the GitHub API listing is only a fallback for repos without one
+    ImageManifest manifest;
+    String latestFilename;
+    String blobSha;
+    bool deviceFailed;
+    if (fetchManifest(&manifest, &deviceFailed)) {
+        latestFilename = manifest.latest;
+    } else if (deviceFailed) {
+        // The API fallback lists the shared image/, not this device's images
+        Serial.println("Device manifest unavailable, keeping the current image");
         enterDeepSleep();
         return;
+    } else {
+        Serial.println("No manifest, falling back to GitHub API");
+        memset(&manifest, 0, sizeof(manifest));
+        latestFilename = getLatestImageFilename(&blobSha);
     }
 
-    // Check if image has changed
-    if (strcmp(latestFilename.c_str(), lastImageFilename) == 0) {
-        Serial.println("Image unchanged, keeping current display");
+    if (latestFilename.length() == 0) {
+        showTemporaryError("No images in repo");
         enterDeepSleep();
         return;
     }
 
-    // Download new image
-    size_t imageSize = 0;
-    uint8_t* imageData = downloadImage(latestFilename, &imageSize);
+    // Prefer the raw 4bpp copy when its format is supported: nothing (or only LZ4) to decode
+    bool useRaw = manifest.raw[0] && RAW4_VERSION_SUPPORTED(manifest.rawVersion);
+    String latestPath = String(manifest.dir[0] ? manifest.dir : IMAGE_DIR) + (useRaw ? String(manifest.raw) : latestFilename);
+    size_t expectedSize = useRaw ? manifest.rawSize : manifest.size;
+    const char* expectedSha256 = useRaw ? manifest.rawSha256 : manifest.sha256;
 
-    if (!imageData) {
-        showTemporaryError("Download failed");
-        enterDeepSleep();
-        return;
+    // The slideshow keeps the latest image and the manifest's queue of previous ones
+    bool caching = SLIDESHOW_SIZE > 1 && mountFlash();
+    String keepNames[SLIDESHOW_SIZE];
+    const char* keep[SLIDESHOW_SIZE];
+    const QueuedImage* keepQueued[SLIDESHOW_SIZE] = {};  // nullptr for the latest image
+    keepNames[0] = latestFilename;
+    keep[0] = keepNames[0].c_str();
+    int keepCount = 1;
+    for (int i = 0; i < manifest.queueCount && keepCount < SLIDESHOW_SIZE; i++) {
+        keepNames[keepCount] = imageNameOf(manifest.queue[i].path);
+        if (keepNames[keepCount] != latestFilename) {
+            keep[keepCount] = keepNames[keepCount].c_str();
+            keepQueued[keepCount] = &manifest.queue[i];
+            keepCount++;
+        }
+    }
+    if (caching) {
+        slideshowRetain(keep, keepCount);
     }
 
-    // Display new image
-    if (displayImage(imageData, imageSize)) {
-        // Update stored filename and mark as valid
-        strncpy(lastImageFilename, latestFilename.c_str(), sizeof(lastImageFilename) - 1);
-        lastImageFilename[sizeof(lastImageFilename) - 1] = '\0';
-        hasValidImage = true;
-        Serial.printf("Successfully updated to: %s\n", lastImageFilename);
+    bool fetched = false;  // A new image was downloaded...
+    bool decoded = false;  // ...and is complete and valid in the frame buffer
+    bool newImage = strcmp(latestFilename.c_str(), lastImageFilename) != 0 && !slideshowFind(latestFilename.c_str());
+    if (newImage && fetchDelta(manifest)) {
+        // Only the changed tiles came over the air; the slideshow keeps the result as a raw file
+        fetched = true;
+        decoded = true;
+        int slot = caching ? slideshowFreeSlot() : -1;
+        if (slot >= 0 && saveRawImage(slideshowSlotPath(slot).c_str())) {
+            slideshowStore(slot, latestFilename.c_str(), true, sizeof(Raw4Header) + FRAME_SIZE);
+        }
+    } else if (newImage) {
+        // Download new image and decode it while it streams in
+        ImageDownload imageStream;
 
-        // Wait to admire the new image
-        delay(2000);
-    } else {
+        if (!imageStream.open(latestPath, expectedSize)) {
+            showTemporaryError("Download failed");
+            enterDeepSleep();
+            return;
+        }
+
+        // Checked against the manifest's SHA-256, or the blob SHA-1 from the API listing
+        if (expectedSha256[0]) {
+            imageStream.expectDigest(expectedSha256);
+        } else {
+            imageStream.expectDigest(blobSha.c_str(), true);
+        }
+
+        // Nothing reaches the panel unless the content is exactly what was published
+        fetched = true;
+        // Received on core 0 while this core decodes (or both here if the pipeline cannot start)
+        PipelinedSource pipe(&imageStream);
+        ImageSource* source = pipe.start() ? (ImageSource*)&pipe : &imageStream;
+        decoded = useRaw ? decodeRawImage(source) : decodeImage(source);
+        pipe.stop();
+        decoded = decoded && imageStream.verified();
+
+        // The staged copy becomes the slideshow's copy
+        int slot = decoded && caching ? slideshowFreeSlot() : -1;
+        if (imageStream.finish(slot >= 0 ? slideshowSlotPath(slot).c_str() : nullptr)) {
+            slideshowStore(slot, latestFilename.c_str(), useRaw, imageStream.size());
+        }
+    }
+
+    // Fill the rest of the queue in the same wake, over the same connection
+    if (caching) {
+        for (int i = 0; i < keepCount; i++) {
+            if (slideshowFind(keep[i])) {
+                continue;
+            }
+            if (keepQueued[i]) {
+                prefetchImage(keepQueued[i]->path, keepQueued[i]->size, keepQueued[i]->sha256);
+            } else if (!fetched || decoded) {
+                // Not again if this wake already downloaded it and it failed
+                prefetchImage(latestPath.c_str(), expectedSize, expectedSha256);
+            }
+        }
+        slideshowSynced();
+    }
+
+    // All network I/O is done: radio off before the panel refresh, so the two
+    // never draw their peak currents at the same time
+    stopWiFi();
+
+    bool shown = false;
+    if (decoded && presentImage()) {
+        markDisplayed(latestFilename.c_str());
+        schedulerNewImage(latestFilename.c_str());
+        shown = true;
+        // Without the slideshow cache, the next delta needs this image kept in flash,
+        // however this one arrived: the next delta is built against it either way
+        if (!caching) {
+            saveDeltaBase(latestFilename.c_str());
+        }
+    } else if (decoded) {
         showTemporaryError("Display failed");
+    } else if (fetched) {
+        // The panel was never touched: the image did not arrive complete, valid and verified
+        showTemporaryError("Download failed");
+    }
+
+    if (!shown) {
+        // Nothing new: carry on with the slideshow, if there is one
+        const Slide* slide = caching ? slideshowNext(lastImageFilename) : nullptr;
+        if (slide && strcmp(slide->name, lastImageFilename) != 0 && showSlide(slide)) {
+            shown = true;
+        } else {
+            Serial.println("Image unchanged, keeping current display");
+        }
     }
 
-    // Cleanup
-    free(imageData);
+    if (shown) {
+        // The panel update is complete when displayPresent() returns (FastEPD drives the
+        // waveform synchronously), so only debug builds linger here
+        waitMs(ADMIRE_DELAY_MS);
+    }
 
     // Enter deep sleep
     enterDeepSleep();
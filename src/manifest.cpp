@@ -0,0 +1,125 @@
+#include "manifest.h"
+#include <string.h>
+
+/**
+ * Span of text [start, end), not NUL terminated
+ */
+struct Span {
+    const char* start;
+    const char* end;
+
+    size_t length() const { return end - start; }
+
+    bool operator==(const char* s) const {
+        return strlen(s) == length() && memcmp(start, s, length()) == 0;
+    }
+};
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+static Span trim(Span span) {
+    while (span.start < span.end && isSpace(*span.start)) {
+        span.start++;
+    }
+    while (span.end > span.start && isSpace(span.end[-1])) {
+        span.end--;
+    }
+    return span;
+}
+
+/**
+ * Split span at its first space: returns what is before it, leaves the rest in
+ * span (empty if there is no space)
+ */
+static Span split(Span* span) {
+    const char* space = (const char*)memchr(span->start, ' ', span->length());
+    Span head = {span->start, space ? space : span->end};
+    span->start = space ? space + 1 : span->end;
+    return head;
+}
+
+/**
+ * Copy a value into a fixed-size field, NUL terminated; too long leaves it empty
+ */
+static void storeField(char* dest, size_t destSize, Span value) {
+    if (value.length() >= destSize) {
+        dest[0] = '\0';
+        return;
+    }
+    memcpy(dest, value.start, value.length());
+    dest[value.length()] = '\0';
+}
+
+/**
+ * Leading decimal digits of a value (0 if none), saturating at UINT32_MAX
+ */
+static uint32_t parseNumber(Span value) {
+    uint64_t number = 0;
+    for (const char* p = value.start; p < value.end && *p >= '0' && *p <= '9'; p++) {
+        number = number * 10 + (*p - '0');
+        if (number > UINT32_MAX) {
+            return UINT32_MAX;
+        }
+    }
+    return (uint32_t)number;
+}
+
+bool parseManifest(const char* text, size_t length, ImageManifest* manifest) {
+    memset(manifest, 0, sizeof(*manifest));
+    uint32_t version = 0;
+
+    const char* end = text + length;
+    const char* start = text;
+    while (start < end) {
+        const char* newline = (const char*)memchr(start, '\n', end - start);
+        Span line = trim({start, newline ? newline : end});
+        start = newline ? newline + 1 : end;
+
+        const char* sep = (const char*)memchr(line.start, ' ', line.length());
+        if (!sep || sep == line.start || *line.start == '#') {
+            continue;
+        }
+
+        Span key = {line.start, sep};
+        Span value = trim({sep + 1, line.end});
+
+        if (key == "version") {
+            version = parseNumber(value);
+        } else if (key == "latest") {
+            storeField(manifest->latest, sizeof(manifest->latest), value);
+        } else if (key == "size") {
+            manifest->size = parseNumber(value);
+        } else if (key == "sha256") {
+            storeField(manifest->sha256, sizeof(manifest->sha256), value);
+        } else if (key == "raw") {
+            storeField(manifest->raw, sizeof(manifest->raw), value);
+        } else if (key == "raw_version") {
+            manifest->rawVersion = parseNumber(value);
+        } else if (key == "raw_size") {
+            manifest->rawSize = parseNumber(value);
+        } else if (key == "raw_sha256") {
+            storeField(manifest->rawSha256, sizeof(manifest->rawSha256), value);
+        } else if (key == "delta") {
+            storeField(manifest->delta, sizeof(manifest->delta), value);
+        } else if (key == "delta_base") {
+            storeField(manifest->deltaBase, sizeof(manifest->deltaBase), value);
+        } else if (key == "delta_size") {
+            manifest->deltaSize = parseNumber(value);
+        } else if (key == "delta_sha256") {
+            storeField(manifest->deltaSha256, sizeof(manifest->deltaSha256), value);
+        } else if (key == "queue" && manifest->queueCount < SLIDESHOW_SIZE) {
+            // "queue <path> <size> <sha256>"
+            QueuedImage* queued = &manifest->queue[manifest->queueCount];
+            storeField(queued->path, sizeof(queued->path), split(&value));
+            queued->size = parseNumber(split(&value));
+            storeField(queued->sha256, sizeof(queued->sha256), value);
+            if (queued->path[0]) {
+                manifest->queueCount++;
+            }
+        }
+    }
+
+    return version == MANIFEST_VERSION && manifest->latest[0] != '\0';
+}
@@ -0,0 +1,69 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+#include "config_defaults.h"
+
+// image/manifest.txt as written by worker.py (see write_manifest()): one
+// "key value" pair per line. Parsed without the Arduino core, so the native
+// unit tests can check it on the build machine.
+#define MANIFEST_VERSION 1
+#define MANIFEST_MAX_SIZE 3072
+#define MANIFEST_QUEUE_MAX 15  // Previous images listed by worker.py (its MANIFEST_QUEUE)
+
+/**
+ * Older image queued for the slideshow
+ */
+struct QueuedImage {
+    char path[48];  // Path in the repository, e.g. output/20240101_120000.png
+    uint32_t size;
+    char sha256[65];
+};
+
+/**
+ * Contents of image/manifest.txt
+ */
+struct ImageManifest {
+    char dir[32];         // Folder the manifest and its images are in, e.g. image/
+    char latest[64];      // Filename of the latest image in dir
+    uint32_t size;        // Size of that file in bytes (0 = unknown)
+    char sha256[65];      // Hex SHA-256 of that file (empty = unknown)
+    char raw[64];         // Raw 4bpp copy of the same image (empty = none)
+    uint8_t rawVersion;
+    uint32_t rawSize;
+    char rawSha256[65];
+    char delta[64];       // Changed tiles against deltaBase (empty = none)
+    char deltaBase[64];   // Image the delta applies to
+    uint32_t deltaSize;
+    char deltaSha256[65];
+    QueuedImage queue[SLIDESHOW_SIZE];  // Previous images, newest first
+    uint8_t queueCount;
+};
+
+// Longest manifest worker.py writes, with every field at the longest value kept above:
+// "key value\n" is sizeof(key) + sizeof(field) for text, at most 10 digits for numbers
+#define MANIFEST_TEXT_LINE(key, field) (sizeof(key) + sizeof(field))
+#define MANIFEST_NUMBER_LINE(key) (sizeof(key) + 11)
+#define MANIFEST_QUEUE_LINE (sizeof("queue") + sizeof(QueuedImage::path) + 11 + sizeof(QueuedImage::sha256))
+static_assert(MANIFEST_NUMBER_LINE("version")
+              + MANIFEST_TEXT_LINE("latest", ImageManifest::latest) + MANIFEST_NUMBER_LINE("size")
+              + MANIFEST_TEXT_LINE("sha256", ImageManifest::sha256)
+              + MANIFEST_TEXT_LINE("raw", ImageManifest::raw) + MANIFEST_NUMBER_LINE("raw_version")
+              + MANIFEST_NUMBER_LINE("raw_size") + MANIFEST_TEXT_LINE("raw_sha256", ImageManifest::rawSha256)
+              + MANIFEST_TEXT_LINE("delta", ImageManifest::delta)
+              + MANIFEST_TEXT_LINE("delta_base", ImageManifest::deltaBase)
+              + MANIFEST_NUMBER_LINE("delta_size") + MANIFEST_TEXT_LINE("delta_sha256", ImageManifest::deltaSha256)
+              + MANIFEST_QUEUE_MAX * MANIFEST_QUEUE_LINE <= MANIFEST_MAX_SIZE,
+              "MANIFEST_MAX_SIZE must hold a full manifest (keep MANIFEST_MAX_SIZE in worker.py equal)");
+
+/**
+ * Parse manifest text (length bytes, need not be NUL terminated): one "key value"
+ * pair per line, unknown keys and lines starting with # are ignored, values too
+ * long for their field are left empty
+ * Returns false unless the version is MANIFEST_VERSION and there is a latest image
+ */
+bool parseManifest(const char* text, size_t length, ImageManifest* manifest);
+
+#endif // MANIFEST_H
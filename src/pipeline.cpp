@@ -0,0 +1,147 @@
+#include "pipeline.h"
+#include "timing.h"
+
+// Receive task: core 0 is where the WiFi and lwIP tasks run already
+#define PIPELINE_CORE 0
+#define PIPELINE_STACK 8192  // Enough for a TLS handshake when a stalled download reconnects
+#define PIPELINE_PRIORITY 2  // Above the loop task (1), so bytes are drained as they arrive
+
+// Longest a side sleeps before checking the ring again (notifications normally wake it sooner)
+#define PIPELINE_POLL_MS 20
+
+/**
+ * The arena's ring region, taken on first use (one pipeline runs at a time)
+ */
+static uint8_t* ringBuffer() {
+    static uint8_t* buffer = PIPELINE_RING_SIZE > 0 ? (uint8_t*)arenaAlloc(ARENA_RING, PIPELINE_RING_SIZE) : nullptr;
+    return buffer;
+}
+
+bool PipelinedSource::start() {
+    if (PIPELINE_RING_SIZE == 0 || _producer) {
+        return false;
+    }
+    _ring = ringBuffer();
+    if (!_ring) {
+        return false;
+    }
+
+    _consumer = xTaskGetCurrentTaskHandle();
+    if (xTaskCreatePinnedToCore(receiveTask, "receive", PIPELINE_STACK, this, PIPELINE_PRIORITY, &_producer,
+                                PIPELINE_CORE) != pdPASS) {
+        Serial.println("Failed to start the receive task, downloading on one core");
+        _producer = nullptr;
+        return false;
+    }
+    Serial.printf("Pipelined download: receive on core %d, decode on core %d\n", PIPELINE_CORE, xPortGetCoreID());
+    return true;
+}
+
+void PipelinedSource::receiveTask(void* arg) {
+    PipelinedSource* self = (PipelinedSource*)arg;
+    self->receive();
+    self->_done.store(true, std::memory_order_release);
+    xTaskNotifyGive(self->_consumer);
+
+    // Stay until stop(), so the decoder can keep notifying this task meanwhile
+    while (!self->_abort.load(std::memory_order_acquire)) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PIPELINE_POLL_MS));
+    }
+    self->_exited.store(true, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+void PipelinedSource::receive() {
+    while (!_abort.load(std::memory_order_acquire)) {
+        // Only this task moves _head; the decoder only ever frees more space
+        size_t head = _head.load(std::memory_order_relaxed);
+        size_t space = PIPELINE_RING_SIZE - (head - _tail.load(std::memory_order_acquire));
+        if (space == 0) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PIPELINE_POLL_MS));
+            continue;
+        }
+
+        // Contiguous free bytes up to the wrap
+        size_t offset = head & (PIPELINE_RING_SIZE - 1);
+        size_t len = min(space, (size_t)PIPELINE_RING_SIZE - offset);
+        int n = _upstream->read(_ring + offset, len);
+        if (n <= 0) {
+            return;
+        }
+        _head.store(head + n, std::memory_order_release);
+        xTaskNotifyGive(_consumer);
+    }
+}
+
+void PipelinedSource::stop() {
+    if (!_producer) {
+        return;
+    }
+    _abort.store(true, std::memory_order_release);
+    xTaskNotifyGive(_producer);
+    while (!_exited.load(std::memory_order_acquire)) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PIPELINE_POLL_MS));
+    }
+    _producer = nullptr;
+}
+
+int PipelinedSource::read(uint8_t* buf, uint32_t len) {
+    if (!_producer) {
+        return 0;
+    }
+
+    // Only this task moves _tail
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    size_t available;
+    while ((available = _head.load(std::memory_order_acquire) - tail) == 0) {
+        // Check _done before _head again: the last bytes are published before it is set
+        if (_done.load(std::memory_order_acquire)) {
+            if (_head.load(std::memory_order_acquire) == tail) {
+                return 0;
+            }
+            continue;
+        }
+        PhaseTimer timer(PHASE_DOWNLOAD);
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PIPELINE_POLL_MS));
+    }
+
+    size_t offset = tail & (PIPELINE_RING_SIZE - 1);
+    size_t n = min(min((size_t)len, available), (size_t)PIPELINE_RING_SIZE - offset);
+    memcpy(buf, _ring + offset, n);
+    _tail.store(tail + n, std::memory_order_release);
+    xTaskNotifyGive(_producer);
+    _pos += n;
+    return n;
+}
+
+void PipelinedSource::skip(int32_t offset) {
+    uint8_t scratch[64];
+    while (offset > 0) {
+        int n = read(scratch, min((int32_t)sizeof(scratch), offset));
+        if (n <= 0) {
+            return;
+        }
+        offset -= n;
+    }
+}
+
+bool PipelinedSource::seek(uint32_t offset) {
+    // Forward only, as the download underneath
+    if (offset < _pos) {
+        return false;
+    }
+    skip(offset - _pos);
+    return _pos == offset;
+}
+
+void PipelinedSource::readToEnd() {
+    uint8_t scratch[256];
+    while (read(scratch, sizeof(scratch)) > 0) {
+    }
+}
+
+size_t PipelinedSource::size() const {
+    // Fixed once the download is open, except that a chunked body learns its
+    // length at the last chunk, on the receive task
+    return _upstream->size();
+}
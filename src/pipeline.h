@@ -0,0 +1,71 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "config.h"
+#include "config_defaults.h"
+#include "arena.h"
+#include "slideshow.h"
+
+static_assert((PIPELINE_RING_SIZE & (PIPELINE_RING_SIZE - 1)) == 0, "PIPELINE_RING_SIZE must be a power of two (0 = off)");
+
+/**
+ * Download and decode on both cores: a task pinned to core 0 (next to the WiFi
+ * stack) reads the upstream source into a single-producer single-consumer ring,
+ * while the decoder reads the ring on the calling task (Arduino's loop task, on
+ * core 1). The ring lives in the arena, so memory stays bounded however large
+ * the image is.
+ * The upstream source must not be touched until stop() returns.
+ */
+class PipelinedSource : public ImageSource {
+public:
+    explicit PipelinedSource(ImageSource* upstream) : _upstream(upstream) {}
+    ~PipelinedSource() { stop(); }
+
+    /**
+     * Start the receive task; false if PIPELINE_RING_SIZE is 0 or the ring or
+     * the task could not be had, in which case read the upstream source directly
+     */
+    bool start();
+
+    /**
+     * Stop the receive task once its current read returns and wait for it
+     * Bytes it received but nobody read are dropped (the upstream source has
+     * still hashed and staged them)
+     */
+    void stop();
+
+    int read(uint8_t* buf, uint32_t len) override;
+    void skip(int32_t offset) override;
+    bool seek(uint32_t offset) override;
+    void close() override {}
+    int32_t tell() override { return _pos; }
+
+    /**
+     * Read and drop everything the receive task still delivers, up to the end of the body
+     */
+    void readToEnd() override;
+
+    size_t received() const override { return _pos; }
+    size_t size() const override;
+
+private:
+    static void receiveTask(void* arg);
+    void receive();
+
+    ImageSource* _upstream;
+    uint8_t* _ring = nullptr;
+    size_t _pos = 0;                 // Bytes handed to the decoder
+    std::atomic<size_t> _head{0};    // Bytes written into the ring (receive task only)
+    std::atomic<size_t> _tail{0};    // Bytes read out of the ring (decoder only)
+    std::atomic<bool> _done{false};   // Receive task finished: no more bytes
+    std::atomic<bool> _abort{false};  // Set by stop()
+    std::atomic<bool> _exited{false}; // Receive task gone
+    TaskHandle_t _producer = nullptr;
+    TaskHandle_t _consumer = nullptr;
+};
+
+#endif // PIPELINE_H
@@ -0,0 +1,210 @@
+#include "scheduler.h"
+#include <time.h>
+#include <sys/time.h>
+
+// PaperS3 battery sense: GPIO3 (ADC1) behind a 1:2 divider
+#define BATTERY_ADC_PIN 3
+#define BATTERY_DIVIDER 2
+#define BATTERY_SAMPLES 8
+
+// Lower readings mean no battery is connected (USB power): don't throttle
+#define BATTERY_PRESENT_MV 2500
+
+// Timestamps kept of the latest new images
+#define ARRIVAL_HISTORY 8
+static_assert(BURST_IMAGES >= 2 && BURST_IMAGES <= ARRIVAL_HISTORY, "BURST_IMAGES must be 2..8");
+
+// Earlier clock values mean the clock was never set (2020-09-13)
+#define CLOCK_VALID_AFTER 1600000000
+
+// Adaptive interval (0 = start from SLEEP_DURATION_US)
+RTC_DATA_ATTR static uint64_t intervalUs = 0;
+
+// Timestamps encoded in the filenames of the latest new images, newest first
+RTC_DATA_ATTR static uint32_t arrivals[ARRIVAL_HISTORY];
+RTC_DATA_ATTR static uint8_t arrivalCount = 0;
+
+/**
+ * What this wake did, deciding the next interval
+ */
+enum WakeOutcome {
+    WAKE_NOTHING_NEW,  // Checked, nothing changed (or the check failed)
+    WAKE_NEW_IMAGE,    // A new image was shown
+    WAKE_SLIDE,        // A cached slideshow image was shown
+};
+
+static WakeOutcome outcome = WAKE_NOTHING_NEW;
+
+// Battery voltage measured this wake (0 = not measured)
+static uint32_t batteryMv = 0;
+
+/**
+ * Days since 1970-01-01 of a proleptic Gregorian date (no timegm() in newlib)
+ */
+static int64_t daysFromCivil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+static time_t civilToEpoch(int year, int month, int day, int hour, int minute, int second) {
+    return (time_t)(daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second);
+}
+
+void schedulerSetClock(const String& httpDate) {
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    char month[4] = {0};
+    int day, year, hour, minute, second;
+
+    if (sscanf(httpDate.c_str(), "%*3s, %d %3s %d %d:%d:%d", &day, month, &year, &hour, &minute, &second) != 6) {
+        return;
+    }
+    const char* found = strlen(month) == 3 ? strstr(months, month) : nullptr;
+    if (!found || (found - months) % 3 != 0) {
+        return;
+    }
+
+    struct timeval now = {civilToEpoch(year, (found - months) / 3 + 1, day, hour, minute, second), 0};
+    settimeofday(&now, nullptr);
+}
+
+void schedulerNewImage(const char* filename) {
+    outcome = WAKE_NEW_IMAGE;
+
+    // YYYYMMDD_HHMMSS: only differences between these are used, so the zone does not matter
+    int year, month, day, hour, minute, second;
+    if (sscanf(filename, "%4d%2d%2d_%2d%2d%2d", &year, &month, &day, &hour, &minute, &second) != 6) {
+        return;
+    }
+    uint32_t timestamp = civilToEpoch(year, month, day, hour, minute, second);
+    if (arrivalCount && arrivals[0] == timestamp) {
+        return;
+    }
+
+    memmove(&arrivals[1], &arrivals[0], sizeof(arrivals) - sizeof(arrivals[0]));
+    arrivals[0] = timestamp;
+    if (arrivalCount < ARRIVAL_HISTORY) {
+        arrivalCount++;
+    }
+}
+
+void schedulerSlideShown() {
+    outcome = WAKE_SLIDE;
+}
+
+bool schedulerCheckBattery() {
+    uint32_t sum = 0;
+    for (int i = 0; i < BATTERY_SAMPLES; i++) {
+        sum += analogReadMilliVolts(BATTERY_ADC_PIN);
+    }
+    batteryMv = sum / BATTERY_SAMPLES * BATTERY_DIVIDER;
+
+    if (batteryMv < BATTERY_PRESENT_MV) {
+        return true;
+    }
+    Serial.printf("Battery: %u mV\n", batteryMv);
+    return batteryMv >= BATTERY_CRITICAL_MV;
+}
+
+/**
+ * Stretch the interval on a low battery: twice as long below BATTERY_LOW_MV,
+ * the longest interval below BATTERY_CRITICAL_MV
+ */
+static uint64_t batteryAdjust(uint64_t sleepUs) {
+    if (batteryMv < BATTERY_PRESENT_MV || batteryMv >= BATTERY_LOW_MV) {
+        return sleepUs;
+    }
+    uint64_t adjusted = batteryMv < BATTERY_CRITICAL_MV ? (uint64_t)SLEEP_MAX_US : min(sleepUs * 2, (uint64_t)SLEEP_MAX_US);
+    adjusted = max(adjusted, sleepUs);
+    Serial.printf("Battery low, sleeping %llu instead of %llu minutes\n", adjusted / 60000000ULL, sleepUs / 60000000ULL);
+    return adjusted;
+}
+
+/**
+ * Lengthen a sleep by a random 0..SLEEP_JITTER_PERCENT, so units powered up
+ * together (or all leaving the quiet hours at once) drift apart instead of
+ * polling the server in lockstep
+ */
+static uint64_t addJitter(uint64_t sleepUs) {
+    uint64_t span = sleepUs * SLEEP_JITTER_PERCENT / 100;
+    return sleepUs + span * (esp_random() & 0xFFFF) / 0x10000;
+}
+
+/**
+ * True when the latest BURST_IMAGES images were made within BURST_WINDOW_S
+ */
+static bool inBurst() {
+    return arrivalCount >= BURST_IMAGES && arrivals[0] >= arrivals[BURST_IMAGES - 1] &&
+           arrivals[0] - arrivals[BURST_IMAGES - 1] <= BURST_WINDOW_S;
+}
+
+/**
+ * Push a wake that would fall into the quiet hours to their end
+ * Needs the clock, so it does nothing until a server reply has set it
+ */
+static uint64_t skipQuietHours(uint64_t sleepUs) {
+    if (QUIET_HOURS_START == QUIET_HOURS_END) {
+        return sleepUs;
+    }
+
+    time_t now = time(nullptr);
+    if (now < CLOCK_VALID_AFTER) {
+        return sleepUs;
+    }
+
+    setenv("TZ", TIMEZONE, 1);
+    tzset();
+
+    time_t wake = now + (time_t)(sleepUs / 1000000ULL);
+    struct tm local;
+    localtime_r(&wake, &local);
+
+    bool quiet = QUIET_HOURS_START < QUIET_HOURS_END
+                     ? local.tm_hour >= QUIET_HOURS_START && local.tm_hour < QUIET_HOURS_END
+                     : local.tm_hour >= QUIET_HOURS_START || local.tm_hour < QUIET_HOURS_END;
+    if (!quiet) {
+        return sleepUs;
+    }
+
+    // Wake when the quiet hours end instead (tomorrow if they end after midnight)
+    if (local.tm_hour >= QUIET_HOURS_END) {
+        local.tm_mday++;
+    }
+    local.tm_hour = QUIET_HOURS_END;
+    local.tm_min = 0;
+    local.tm_sec = 0;
+    local.tm_isdst = -1;
+    time_t end = mktime(&local);
+
+    Serial.printf("Quiet hours: sleeping until %02d:00\n", QUIET_HOURS_END);
+    return end > now ? (uint64_t)(end - now) * 1000000ULL : sleepUs;
+}
+
+uint64_t schedulerSleepUs() {
+    if (intervalUs == 0) {
+        intervalUs = SLEEP_DURATION_US;
+    }
+
+    uint64_t sleepUs;
+    switch (outcome) {
+        case WAKE_NEW_IMAGE:
+            // Content is moving: back to the base interval, faster while images keep coming
+            intervalUs = inBurst() ? SLEEP_MIN_US : SLEEP_DURATION_US;
+            sleepUs = intervalUs;
+            break;
+        case WAKE_SLIDE:
+            // The slideshow keeps its pace; only checks that find nothing back off
+            sleepUs = SLEEP_DURATION_US;
+            break;
+        default:
+            // Exponential backoff while nothing changes
+            intervalUs = min(intervalUs * 2, (uint64_t)SLEEP_MAX_US);
+            sleepUs = intervalUs;
+            break;
+    }
+
+    return addJitter(skipQuietHours(batteryAdjust(sleepUs)));
+}
@@ -0,0 +1,35 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "config_defaults.h"
+
+/**
+ * Set the system clock from an HTTP Date header ("Wed, 21 Oct 2015 07:28:00 GMT")
+ * The RTC keeps it running through deep sleep, so once per boot is enough
+ */
+void schedulerSetClock(const String& httpDate);
+
+/**
+ * Record that a new image (named YYYYMMDD_HHMMSS.*) was found and shown
+ */
+void schedulerNewImage(const char* filename);
+
+/**
+ * Record that this wake showed a cached slideshow image
+ */
+void schedulerSlideShown();
+
+/**
+ * Measure the battery (do this first thing, before the radio loads it)
+ * Returns false when it is too low to do anything but sleep
+ */
+bool schedulerCheckBattery();
+
+/**
+ * How long to sleep after this wake: the adaptive interval, moved past quiet hours
+ */
+uint64_t schedulerSleepUs();
+
+#endif // SCHEDULER_H
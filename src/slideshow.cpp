@@ -0,0 +1,146 @@
+#include "slideshow.h"
+
+// Slot table: slot i is the file slideshowSlotPath(i)
+RTC_DATA_ATTR static Slide slides[SLIDESHOW_SIZE];
+
+// Offline wakes left before the queue is refreshed
+RTC_DATA_ATTR static uint8_t wakesUntilSync = 0;
+
+bool FileImageSource::open(const String& path) {
+    _file = LittleFS.open(path, "r");
+    if (!_file) {
+        return false;
+    }
+    _size = _file.size();
+    _pos = 0;
+    return _size > 0;
+}
+
+int FileImageSource::read(uint8_t* buf, uint32_t len) {
+    size_t want = min((size_t)len, _size - _pos);
+    if (want == 0) {
+        return 0;
+    }
+    int n = _file.read(buf, want);
+    if (n <= 0) {
+        return 0;
+    }
+    _pos += n;
+    return n;
+}
+
+void FileImageSource::skip(int32_t offset) {
+    seek(_pos + offset);
+}
+
+bool FileImageSource::seek(uint32_t offset) {
+    if (offset > _size || !_file.seek(offset)) {
+        return false;
+    }
+    _pos = offset;
+    return true;
+}
+
+const Slide* slideshowFind(const char* name) {
+    for (int i = 0; i < SLIDESHOW_SIZE; i++) {
+        if (slides[i].name[0] && strcmp(slides[i].name, name) == 0) {
+            return &slides[i];
+        }
+    }
+    return nullptr;
+}
+
+const Slide* slideshowNext(const char* current) {
+    const Slide* first = nullptr;
+    const Slide* next = nullptr;
+    for (int i = 0; i < SLIDESHOW_SIZE; i++) {
+        const Slide* slide = &slides[i];
+        if (!slide->name[0]) {
+            continue;
+        }
+        if (!first || strcmp(slide->name, first->name) < 0) {
+            first = slide;
+        }
+        if (strcmp(slide->name, current) > 0 && (!next || strcmp(slide->name, next->name) < 0)) {
+            next = slide;
+        }
+    }
+    return next ? next : first;
+}
+
+int slideshowCount() {
+    int count = 0;
+    for (int i = 0; i < SLIDESHOW_SIZE; i++) {
+        if (slides[i].name[0]) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void slideshowRetain(const char* const* names, int count) {
+    for (int i = 0; i < SLIDESHOW_SIZE; i++) {
+        if (!slides[i].name[0]) {
+            continue;
+        }
+        bool keep = false;
+        for (int n = 0; n < count && !keep; n++) {
+            keep = strcmp(slides[i].name, names[n]) == 0;
+        }
+        if (!keep) {
+            Serial.printf("Dropping cached image: %s\n", slides[i].name);
+            LittleFS.remove(slideshowSlotPath(i));
+            memset(&slides[i], 0, sizeof(slides[i]));
+        }
+    }
+}
+
+int slideshowFreeSlot() {
+    for (int i = 0; i < SLIDESHOW_SIZE; i++) {
+        if (!slides[i].name[0]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+String slideshowSlotPath(int slot) {
+    return String("/slide") + slot + ".img";
+}
+
+String slideshowPath(const Slide* slide) {
+    return slideshowSlotPath(slide - slides);
+}
+
+void slideshowStore(int slot, const char* name, bool raw, uint32_t size) {
+    Slide* slide = &slides[slot];
+    strncpy(slide->name, name, sizeof(slide->name) - 1);
+    slide->name[sizeof(slide->name) - 1] = '\0';
+    slide->raw = raw;
+    slide->size = size;
+}
+
+void slideshowRemove(const char* name) {
+    const Slide* slide = slideshowFind(name);
+    if (slide) {
+        int slot = slide - slides;
+        LittleFS.remove(slideshowSlotPath(slot));
+        memset(&slides[slot], 0, sizeof(slides[slot]));
+    }
+}
+
+bool slideshowSyncDue() {
+    return wakesUntilSync == 0 || slideshowCount() == 0;
+}
+
+void slideshowSynced() {
+    // This wake shows one slide, the others each get an offline wake
+    int count = slideshowCount();
+    wakesUntilSync = count > 1 ? count - 1 : 0;
+}
+
+void slideshowOfflineWake() {
+    if (wakesUntilSync > 0) {
+        wakesUntilSync--;
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef SLIDESHOW_H
+#define SLIDESHOW_H
+
+#include <Arduino.h>
+#include <M5GFX.h>
+#include <LittleFS.h>
+#include "config.h"
+#include "config_defaults.h"
+
+// The manifest is parsed on the stack, with a hashed queue entry per slot
+static_assert(SLIDESHOW_SIZE >= 1 && SLIDESHOW_SIZE <= 16, "SLIDESHOW_SIZE must be 1..16");
+
+/**
+ * Byte source for the image decoders: a download or a file cached in flash
+ */
+class ImageSource : public lgfx::DataWrapper {
+public:
+    virtual size_t received() const = 0;
+    virtual size_t size() const = 0;
+    bool complete() const { return size() && received() == size(); }
+
+    /**
+     * Consume what is left up to a body end the size did not announce (a
+     * chunked download only learns its length at the last chunk)
+     */
+    virtual void readToEnd() {}
+};
+
+/**
+ * Image file read back from flash (LittleFS must be mounted)
+ */
+class FileImageSource : public ImageSource {
+public:
+    bool open(const String& path);
+    int read(uint8_t* buf, uint32_t len) override;
+    void skip(int32_t offset) override;
+    bool seek(uint32_t offset) override;
+    void close() override { _file.close(); }
+    int32_t tell() override { return _pos; }
+
+    size_t received() const override { return _pos; }
+    size_t size() const override { return _size; }
+
+private:
+    File _file;
+    size_t _size = 0;
+    size_t _pos = 0;
+};
+
+/**
+ * Image cached in flash for display without the radio
+ * Each slot owns one file on LittleFS; the slot table is kept in RTC memory
+ */
+struct Slide {
+    char name[64];  // Image name as stored in lastImageFilename (empty = free slot)
+    uint32_t size;  // File size in bytes
+    bool raw;       // Raw 4bpp file, PNG otherwise
+};
+
+/**
+ * Cached slide with this image name, nullptr if none
+ */
+const Slide* slideshowFind(const char* name);
+
+/**
+ * Slide to show after the one named current: the next name in order (names are
+ * timestamps, so this plays the images chronologically), wrapping around
+ * nullptr if nothing is cached
+ */
+const Slide* slideshowNext(const char* current);
+
+/**
+ * Number of cached slides
+ */
+int slideshowCount();
+
+/**
+ * Free the slots of every image not in names, deleting their files
+ */
+void slideshowRetain(const char* const* names, int count);
+
+/**
+ * Index of a free slot, -1 if all are taken
+ */
+int slideshowFreeSlot();
+
+/**
+ * LittleFS path of a slot's file (of a slide's file for the overload)
+ */
+String slideshowSlotPath(int slot);
+String slideshowPath(const Slide* slide);
+
+/**
+ * Record that the file at slideshowSlotPath(slot) now holds this image
+ */
+void slideshowStore(int slot, const char* name, bool raw, uint32_t size);
+
+/**
+ * Drop a slide (e.g. its file turned out to be corrupt)
+ */
+void slideshowRemove(const char* name);
+
+/**
+ * True when this wake should go online to refresh the queue: once per lap
+ * through the cached slides, and whenever nothing is cached
+ */
+bool slideshowSyncDue();
+
+/**
+ * Start a new lap after the queue was refreshed
+ */
+void slideshowSynced();
+
+/**
+ * Count down an offline wake
+ */
+void slideshowOfflineWake();
+
+#endif // SLIDESHOW_H
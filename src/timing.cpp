@@ -0,0 +1,72 @@
+#include "timing.h"
+
+// Wakes kept in RTC memory for the rolling figures
+#define TIMING_HISTORY 16
+
+static const char* const phaseNames[PHASE_COUNT] = {
+    "boot", "wifi", "dns", "tls", "request", "parse", "download", "decode", "refresh", "wait", "total",
+};
+
+// Milliseconds per phase of the last wakes (saturating at 65.5 s)
+RTC_DATA_ATTR static uint16_t history[TIMING_HISTORY][PHASE_COUNT];
+RTC_DATA_ATTR static uint8_t historyNext = 0;
+RTC_DATA_ATTR static uint8_t historyCount = 0;
+
+static int64_t phaseUs[PHASE_COUNT];
+
+// The task that timed the boot; a pipelined download's receive task runs
+// alongside it, and what that costs the wake is the time this one waits
+static TaskHandle_t timedTask = nullptr;
+
+void timingAdd(Phase phase, int64_t us) {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    if (!timedTask) {
+        timedTask = task;
+    } else if (task != timedTask) {
+        return;
+    }
+    phaseUs[phase] += us;
+}
+
+int64_t timingGet(Phase phase) {
+    return phaseUs[phase];
+}
+
+void timingFinish() {
+    // The timer starts with the app, so this is the time since reset
+    phaseUs[PHASE_TOTAL] = esp_timer_get_time();
+
+    uint16_t* wake = history[historyNext];
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        int64_t ms = phaseUs[p] / 1000;
+        wake[p] = ms > UINT16_MAX ? UINT16_MAX : (ms < 0 ? 0 : ms);
+    }
+    historyNext = (historyNext + 1) % TIMING_HISTORY;
+    if (historyCount < TIMING_HISTORY) {
+        historyCount++;
+    }
+
+    char line[256];
+    int len = snprintf(line, sizeof(line), "Wake timing (ms):");
+    for (int p = 0; p < PHASE_COUNT && len < (int)sizeof(line); p++) {
+        if (wake[p] || p == PHASE_TOTAL) {
+            len += snprintf(line + len, sizeof(line) - len, " %s %u", phaseNames[p], wake[p]);
+        }
+    }
+    Serial.println(line);
+
+    len = snprintf(line, sizeof(line), "Last %u wakes min/avg/max (ms):", historyCount);
+    for (int p = 0; p < PHASE_COUNT && len < (int)sizeof(line); p++) {
+        uint32_t lo = UINT16_MAX, hi = 0, sum = 0;
+        for (int i = 0; i < historyCount; i++) {
+            uint16_t ms = history[i][p];
+            lo = ms < lo ? ms : lo;
+            hi = ms > hi ? ms : hi;
+            sum += ms;
+        }
+        if (hi) {
+            len += snprintf(line + len, sizeof(line) - len, " %s %u/%u/%u", phaseNames[p], lo, sum / historyCount, hi);
+        }
+    }
+    Serial.println(line);
+}
@@ -0,0 +1,56 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/**
+ * Phases of a wake, timed separately
+ */
+enum Phase {
+    PHASE_BOOT,      // Reset to setup()
+    PHASE_WIFI,      // Association and IP
+    PHASE_DNS,
+    PHASE_TLS,       // TLS handshakes
+    PHASE_REQUEST,   // Manifest / API request until the response headers
+    PHASE_PARSE,     // Manifest / API listing parse
+    PHASE_DOWNLOAD,  // Waiting for image bytes (the decode runs while they stream in)
+    PHASE_DECODE,    // Decoding into the frame, download waits excluded
+    PHASE_REFRESH,   // Panel update
+    PHASE_WAIT,      // Fixed delays
+    PHASE_TOTAL,     // Reset to deep sleep
+    PHASE_COUNT
+};
+
+/**
+ * Add time to a phase of this wake (only calls from the main task count)
+ */
+void timingAdd(Phase phase, int64_t us);
+
+/**
+ * Time spent in a phase so far this wake
+ */
+int64_t timingGet(Phase phase);
+
+/**
+ * Store this wake in the RTC history and print it with min/avg/max over the
+ * last wakes; call just before deep sleep
+ */
+void timingFinish();
+
+/**
+ * Times its scope into a phase
+ */
+class PhaseTimer {
+public:
+    explicit PhaseTimer(Phase phase) : _phase(phase), _start(esp_timer_get_time()) {}
+    ~PhaseTimer() { timingAdd(_phase, esp_timer_get_time() - _start); }
+
+private:
+    Phase _phase;
+    int64_t _start;
+};
+
+#endif // TIMING_H
@@ -0,0 +1,9 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+// Configuration for the native unit tests (env:native), used when there is no
+// src/config.h: only the options the modules under test read, the others come
+// from config_defaults.h
+#define SLIDESHOW_SIZE 4
+
+#endif // CONFIG_H
@@ -0,0 +1,128 @@
+// Chunked transfer framing (src/chunked.cpp) on the build machine: `pio test -e native`
+#include <unity.h>
+#include <string>
+#include "chunked.h"
+
+/**
+ * Read a chunked body the way ImageDownload::readNetwork() does: framing bytes
+ * one at a time, data up to left() in reads of at most step bytes
+ * Returns false on a malformed size line; *consumed is where reading stopped
+ */
+static bool decode(const std::string& wire, size_t step, std::string* body, size_t* consumed) {
+    ChunkedFraming framing;
+    framing.reset();
+    size_t pos = 0;
+    while (pos < wire.size() && !framing.done()) {
+        if (framing.left() == 0) {
+            if (!framing.feed(wire[pos++])) {
+                *consumed = pos;
+                return false;
+            }
+            continue;
+        }
+        size_t n = framing.left() < step ? framing.left() : step;
+        n = n < wire.size() - pos ? n : wire.size() - pos;
+        body->append(wire, pos, n);
+        framing.consume(n);
+        pos += n;
+    }
+    *consumed = pos;
+    return framing.done();
+}
+
+static void test_body() {
+    const std::string wire = "5\r\nhello\r\n1A\r\nabcdefghijklmnopqrstuvwxyz\r\n0\r\n\r\nNEXT";
+    const size_t steps[] = {1, 3, 1024};
+    for (size_t step : steps) {
+        std::string body;
+        size_t consumed;
+        TEST_ASSERT_TRUE(decode(wire, step, &body, &consumed));
+        TEST_ASSERT_EQUAL_STRING("helloabcdefghijklmnopqrstuvwxyz", body.c_str());
+        TEST_ASSERT_EQUAL_INT(wire.size() - 4, consumed);  // Stops at the end of the body
+    }
+}
+
+static void test_extensions_and_trailer() {
+    // Chunk extensions are ignored, trailer fields are skipped up to the blank line
+    const std::string wire = "4;name=value\r\nWiki\r\n0;last\r\nExpires: never\r\nX-Sum: 1\r\n\r\n";
+    std::string body;
+    size_t consumed;
+    TEST_ASSERT_TRUE(decode(wire, 1024, &body, &consumed));
+    TEST_ASSERT_EQUAL_STRING("Wiki", body.c_str());
+    TEST_ASSERT_EQUAL_INT(wire.size(), consumed);
+}
+
+static void test_bare_newlines() {
+    const std::string wire = "3\nabc\n0\n\n";
+    std::string body;
+    size_t consumed;
+    TEST_ASSERT_TRUE(decode(wire, 1024, &body, &consumed));
+    TEST_ASSERT_EQUAL_STRING("abc", body.c_str());
+}
+
+static void test_large_chunk_size() {
+    ChunkedFraming framing;
+    framing.reset();
+    const std::string line = "3F4A0\r\n";
+    for (char c : line) {
+        TEST_ASSERT_TRUE(framing.feed(c));
+    }
+    TEST_ASSERT_EQUAL_INT(0x3F4A0, framing.left());
+    framing.consume(0x3F4A0);
+    TEST_ASSERT_EQUAL_INT(0, framing.left());
+    TEST_ASSERT_FALSE(framing.done());
+}
+
+static void test_malformed() {
+    std::string body;
+    size_t consumed;
+    TEST_ASSERT_FALSE(decode("zz\r\nhello\r\n0\r\n\r\n", 1024, &body, &consumed));
+    TEST_ASSERT_EQUAL_INT(4, consumed);
+
+    ChunkedFraming framing;
+    framing.reset();
+    for (char c : std::string("xyz\r\n")) {
+        framing.feed(c);
+    }
+    TEST_ASSERT_EQUAL_STRING("xyz", framing.line());
+}
+
+static void test_truncated() {
+    // The connection ended inside a chunk: not done, the rest is still owed
+    ChunkedFraming framing;
+    framing.reset();
+    for (char c : std::string("10\r\n")) {
+        framing.feed(c);
+    }
+    framing.consume(6);
+    TEST_ASSERT_EQUAL_INT(10, framing.left());
+    TEST_ASSERT_FALSE(framing.done());
+}
+
+static void test_reset() {
+    ChunkedFraming framing;
+    framing.reset();
+    for (char c : std::string("0\r\n\r\n")) {
+        framing.feed(c);
+    }
+    TEST_ASSERT_TRUE(framing.done());
+    framing.reset();
+    TEST_ASSERT_FALSE(framing.done());
+    TEST_ASSERT_EQUAL_INT(0, framing.left());
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_body);
+    RUN_TEST(test_extensions_and_trailer);
+    RUN_TEST(test_bare_newlines);
+    RUN_TEST(test_large_chunk_size);
+    RUN_TEST(test_malformed);
+    RUN_TEST(test_truncated);
+    RUN_TEST(test_reset);
+    return UNITY_END();
+}
@@ -0,0 +1,260 @@
+// LZ4 block decoder (src/lz4.h) against blocks from worker.py and a reference
+// encoder, on the build machine: `pio test -e native`
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "lz4.h"
+
+/**
+ * Byte source over a buffer, handing out at most chunk bytes per read like a
+ * network stream
+ */
+class MemorySource {
+public:
+    MemorySource(const std::vector<uint8_t>& data, size_t chunk = 1460) : _data(data), _chunk(chunk) {}
+
+    int read(uint8_t* buf, uint32_t len) {
+        size_t n = _data.size() - _pos;
+        n = n < len ? n : len;
+        n = n < _chunk ? n : _chunk;
+        memcpy(buf, _data.data() + _pos, n);
+        _pos += n;
+        return n;
+    }
+
+private:
+    const std::vector<uint8_t>& _data;
+    size_t _chunk;
+    size_t _pos = 0;
+};
+
+static uint32_t lcgState;
+
+static uint8_t lcgNext() {
+    lcgState = (lcgState * 1103515245 + 12345) & 0x7fffffff;
+    return (lcgState >> 16) & 0xff;
+}
+
+/**
+ * The payload worker.py compressed into WORKER_BLOCK: pixel pair runs, a repeated
+ * row, noise longer than 15 + 255 literals and a run longer than 15 + 255 + 4
+ */
+static std::vector<uint8_t> workerPayload() {
+    std::vector<uint8_t> out(300, 0x77);
+    for (int i = 0; i < 20; i++) {
+        const char* row = "0123456789abcdef";
+        out.insert(out.end(), row, row + 16);
+    }
+    lcgState = 1;
+    for (int i = 0; i < 400; i++) {
+        out.push_back(lcgNext());
+    }
+    out.insert(out.end(), 600, 0xff);
+    for (int i = 0; i < 20; i++) {
+        out.push_back(lcgNext());
+    }
+    return out;
+}
+
+// worker.lz4_compress(workerPayload())
+static const uint8_t WORKER_BLOCK[] = {
+    0x1f, 0x77, 0x01, 0x00, 0xff, 0x19, 0xff, 0x01, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37,
+    0x38, 0x39, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x10, 0x00, 0xff, 0x1e, 0xff, 0xff, 0x83, 0xc6,
+    0x7e, 0x81, 0x6b, 0x4b, 0xfb, 0xe2, 0xfb, 0x54, 0xf6, 0xbd, 0xdf, 0x7c, 0x1c, 0xe1, 0x87, 0x01,
+    0xbf, 0x31, 0xde, 0x56, 0x72, 0x0f, 0x47, 0x67, 0x66, 0x87, 0x59, 0xaa, 0x88, 0x3c, 0x59, 0xea,
+    0x56, 0x13, 0x7b, 0xd2, 0x85, 0xa1, 0xd8, 0x3c, 0x54, 0x55, 0x2f, 0x37, 0xae, 0x65, 0x5b, 0xda,
+    0x02, 0x79, 0x98, 0xcc, 0xe3, 0x1a, 0x76, 0x8e, 0x5f, 0xd9, 0x99, 0x8f, 0x1f, 0x3f, 0x36, 0xee,
+    0x43, 0x78, 0x4d, 0x0d, 0xfa, 0xbe, 0xa6, 0xda, 0xe4, 0x86, 0x8e, 0xdc, 0x29, 0x6d, 0x4e, 0xff,
+    0x56, 0xe1, 0x70, 0x20, 0xfb, 0x8f, 0xb1, 0x58, 0x05, 0x90, 0xc5, 0x09, 0xdc, 0x53, 0xcd, 0xaa,
+    0x3b, 0x48, 0x99, 0x52, 0xd3, 0x52, 0x9d, 0x06, 0x9f, 0xea, 0xb5, 0xc2, 0x06, 0x13, 0x98, 0x49,
+    0xb2, 0x01, 0x1e, 0xac, 0x32, 0x88, 0x31, 0x9c, 0x52, 0x46, 0x95, 0x71, 0x36, 0x8f, 0x57, 0xf6,
+    0x39, 0x1d, 0x16, 0xfa, 0x88, 0x74, 0xf5, 0x98, 0x7c, 0x17, 0x5c, 0x41, 0xbb, 0x6d, 0x71, 0x8e,
+    0x0f, 0x70, 0x59, 0xc7, 0x01, 0x1b, 0x2f, 0x33, 0x3d, 0x91, 0xc0, 0x1d, 0xa5, 0x0d, 0x0d, 0xab,
+    0x33, 0x8d, 0x7e, 0x5e, 0x8f, 0x3e, 0xe6, 0x68, 0x74, 0xa6, 0x3a, 0xb1, 0xc3, 0x93, 0x11, 0xa8,
+    0x64, 0xc7, 0xdb, 0xca, 0xe0, 0x60, 0xe1, 0xf3, 0xbf, 0x09, 0x00, 0x67, 0xa2, 0xe3, 0x25, 0xa0,
+    0x21, 0x31, 0x87, 0xd5, 0x62, 0xc5, 0xa8, 0x4f, 0x7e, 0x2e, 0x09, 0x6b, 0x94, 0x9f, 0xb0, 0x6d,
+    0xa9, 0x9e, 0x5a, 0x0b, 0x46, 0x70, 0x80, 0xb6, 0xcf, 0x47, 0x0c, 0xa6, 0xa5, 0x2a, 0xd8, 0xac,
+    0xfb, 0xa0, 0xeb, 0xb7, 0x79, 0x24, 0x72, 0x23, 0x92, 0x48, 0x80, 0xc5, 0xa6, 0xa7, 0x85, 0xb7,
+    0xd7, 0x8c, 0x90, 0xe4, 0xab, 0x63, 0x44, 0x52, 0x66, 0xe3, 0x9c, 0x33, 0x25, 0xf9, 0x5e, 0xaa,
+    0xba, 0x73, 0x60, 0x5d, 0x4b, 0x71, 0x7e, 0xbe, 0xa9, 0x8c, 0x57, 0x19, 0x71, 0xc3, 0xca, 0x5e,
+    0xe5, 0x2a, 0x33, 0xac, 0x88, 0x51, 0x66, 0xa1, 0x7b, 0x75, 0x67, 0x64, 0x9a, 0x69, 0xef, 0x6f,
+    0x56, 0x42, 0xa0, 0x1d, 0x51, 0xc5, 0x02, 0xf7, 0xbb, 0x92, 0x45, 0xbe, 0x6f, 0x0d, 0xb6, 0x38,
+    0xcc, 0x10, 0xfd, 0xbb, 0x54, 0x51, 0x1c, 0x7b, 0x07, 0x94, 0x27, 0x93, 0x7d, 0x92, 0xc3, 0xd4,
+    0xc6, 0xa5, 0x61, 0x51, 0x01, 0x38, 0x38, 0xa7, 0xbf, 0xf1, 0x04, 0x0d, 0x15, 0x9b, 0x80, 0x1f,
+    0x83, 0xd5, 0xa4, 0x69, 0x88, 0x7c, 0x9f, 0xb6, 0x01, 0xda, 0x93, 0x17, 0x45, 0x8b, 0x12, 0xb2,
+    0x02, 0x33, 0x5c, 0x50, 0xd6, 0xe1, 0x56, 0xa4, 0xad, 0x42, 0x4a, 0x5c, 0xdd, 0x86, 0x61, 0xe9,
+    0x03, 0x12, 0xe1, 0x0f, 0x9b, 0xea, 0x26, 0x2c, 0x61, 0xdc, 0x62, 0x48, 0x6b, 0x6d, 0x14, 0xe0,
+    0x03, 0x85, 0x4a, 0x72, 0x46, 0xda, 0x96, 0xc8, 0x7d, 0x1c, 0xd1, 0x05, 0x3e, 0xe5, 0x92, 0xff,
+    0x01, 0x00, 0xff, 0xff, 0x46, 0xf0, 0x05, 0x70, 0x43, 0x5f, 0x6c, 0x03, 0x05, 0xb3, 0xeb, 0xb3,
+    0x20, 0x35, 0x4d, 0x7e, 0x66, 0x50, 0x01, 0x36, 0xc0, 0x33, 0xe1,
+};
+
+static void appendLength(std::vector<uint8_t>* out, size_t length) {
+    for (; length >= 255; length -= 255) {
+        out->push_back(255);
+    }
+    out->push_back(length);
+}
+
+static void appendSequence(std::vector<uint8_t>* out, const uint8_t* literals, size_t literalCount,
+                           size_t offset, size_t match) {
+    size_t matchCode = match ? match - 4 : 0;
+    out->push_back((literalCount < 15 ? literalCount : 15) << 4 | (matchCode < 15 ? matchCode : 15));
+    if (literalCount >= 15) {
+        appendLength(out, literalCount - 15);
+    }
+    out->insert(out->end(), literals, literals + literalCount);
+    if (match) {
+        out->push_back(offset & 0xff);
+        out->push_back(offset >> 8);
+        if (matchCode >= 15) {
+            appendLength(out, matchCode - 15);
+        }
+    }
+}
+
+/**
+ * Greedy LZ4 block encoder (one hash slot per 4-byte prefix), following the
+ * end of block rules: no match in the last 12 bytes, the last 5 are literals
+ */
+static std::vector<uint8_t> compress(const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> out;
+    std::vector<long> table(1 << 12, -1);
+    size_t n = data.size();
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (n >= 13 && pos + 12 < n) {
+        uint32_t prefix;
+        memcpy(&prefix, &data[pos], 4);
+        uint32_t slot = (prefix * 2654435761u) >> 20;
+        long candidate = table[slot];
+        table[slot] = pos;
+        if (candidate < 0 || pos - candidate > 0xffff || memcmp(&data[candidate], &data[pos], 4) != 0) {
+            pos++;
+            continue;
+        }
+        size_t match = 4;
+        while (pos + match < n - 5 && data[candidate + match] == data[pos + match]) {
+            match++;
+        }
+        appendSequence(&out, &data[anchor], pos - anchor, pos - candidate, match);
+        pos += match;
+        anchor = pos;
+    }
+    appendSequence(&out, data.data() + anchor, n - anchor, 0, 0);
+    return out;
+}
+
+/**
+ * Dithered-looking frame: flat areas of one pixel pair, rows repeating the
+ * row above, and noise
+ */
+static std::vector<uint8_t> framePayload(size_t size) {
+    std::vector<uint8_t> out(size);
+    lcgState = 7;
+    for (size_t i = 0; i < size; i++) {
+        size_t block = (i / 512) % 3;
+        out[i] = block == 0 ? 0x88 : (block == 1 && i >= 270 ? out[i - 270] : lcgNext());
+    }
+    return out;
+}
+
+static void test_worker_block() {
+    std::vector<uint8_t> block(WORKER_BLOCK, WORKER_BLOCK + sizeof(WORKER_BLOCK));
+    std::vector<uint8_t> expected = workerPayload();
+    std::vector<uint8_t> out(expected.size());
+    MemorySource source(block);
+    TEST_ASSERT_EQUAL_INT(expected.size(), inflateLz4(&source, out.data(), out.size()));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected.data(), out.data(), expected.size());
+}
+
+static void test_round_trip_frame() {
+    std::vector<uint8_t> frame = framePayload(540 * 960 / 2);
+    std::vector<uint8_t> block = compress(frame);
+    TEST_ASSERT_LESS_THAN(frame.size(), block.size());
+
+    // Reads of every size the decoder can meet: single bytes, odd and full packets
+    const size_t chunks[] = {1, 7, 255, 256, 1460, 1 << 20};
+    for (size_t chunk : chunks) {
+        std::vector<uint8_t> out(frame.size());
+        MemorySource source(block, chunk);
+        TEST_ASSERT_EQUAL_INT(frame.size(), inflateLz4(&source, out.data(), out.size()));
+        TEST_ASSERT_TRUE(out == frame);
+    }
+}
+
+static void test_round_trip_small() {
+    // Blocks shorter than the end of block margins are all literals
+    for (size_t size = 1; size < 40; size++) {
+        std::vector<uint8_t> data = framePayload(size);
+        std::vector<uint8_t> block = compress(data);
+        std::vector<uint8_t> out(size);
+        MemorySource source(block);
+        TEST_ASSERT_EQUAL_INT(size, inflateLz4(&source, out.data(), out.size()));
+        TEST_ASSERT_TRUE(out == data);
+    }
+}
+
+static void test_truncated() {
+    std::vector<uint8_t> frame = framePayload(4096);
+    std::vector<uint8_t> block = compress(frame);
+    block.resize(block.size() / 2);
+    std::vector<uint8_t> out(frame.size());
+    MemorySource source(block);
+    int n = inflateLz4(&source, out.data(), out.size());
+    TEST_ASSERT_GREATER_OR_EQUAL(0, n);
+    TEST_ASSERT_LESS_THAN(frame.size(), n);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(frame.data(), out.data(), n);
+}
+
+static void test_corrupt() {
+    std::vector<uint8_t> out(64);
+
+    // Match before the start of the output
+    std::vector<uint8_t> before = {0x10, 'a', 0x02, 0x00, 0x50, 'b', 'c', 'd', 'e', 'f'};
+    MemorySource beforeSource(before);
+    TEST_ASSERT_EQUAL_INT(-1, inflateLz4(&beforeSource, out.data(), 10));
+
+    // Offset 0
+    std::vector<uint8_t> zero = {0x10, 'a', 0x00, 0x00, 0x50, 'b', 'c', 'd', 'e', 'f'};
+    MemorySource zeroSource(zero);
+    TEST_ASSERT_EQUAL_INT(-1, inflateLz4(&zeroSource, out.data(), 10));
+
+    // More output than the frame holds
+    std::vector<uint8_t> overflow = {0x1f, 'a', 0x01, 0x00, 0xff, 0x10};
+    MemorySource overflowSource(overflow);
+    TEST_ASSERT_EQUAL_INT(-1, inflateLz4(&overflowSource, out.data(), out.size()));
+
+    // Bytes after the block ended
+    std::vector<uint8_t> trailing = {0x40, 'a', 'b', 'c', 'd', 0x00};
+    MemorySource trailingSource(trailing);
+    TEST_ASSERT_EQUAL_INT(-1, inflateLz4(&trailingSource, out.data(), 4));
+}
+
+static void test_overlapping_match() {
+    // One literal pixel pair, then a match at offset 1 repeating it 19 times
+    std::vector<uint8_t> block = {0x1f, 0x5a, 0x01, 0x00, 0x00, 0x50, 1, 2, 3, 4, 5};
+    std::vector<uint8_t> out(25);
+    MemorySource source(block);
+    TEST_ASSERT_EQUAL_INT(25, inflateLz4(&source, out.data(), out.size()));
+    for (int i = 0; i < 20; i++) {
+        TEST_ASSERT_EQUAL_HEX8(0x5a, out[i]);
+    }
+    TEST_ASSERT_EQUAL_HEX8(5, out[24]);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_worker_block);
+    RUN_TEST(test_round_trip_frame);
+    RUN_TEST(test_round_trip_small);
+    RUN_TEST(test_truncated);
+    RUN_TEST(test_corrupt);
+    RUN_TEST(test_overlapping_match);
+    return UNITY_END();
+}
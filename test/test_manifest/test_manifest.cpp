@@ -0,0 +1,140 @@
+// Manifest parser (src/manifest.cpp) on the build machine: `pio test -e native`
+#include <unity.h>
+#include <string.h>
+#include <string>
+#include "manifest.h"
+
+static const char* SHA_A = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+static const char* SHA_B = "fedcba9876543210fedcba9876543210fedcba9876543210fedcba9876543210";
+
+static bool parse(const std::string& text, ImageManifest* manifest) {
+    return parseManifest(text.data(), text.size(), manifest);
+}
+
+static std::string queueLine(int i) {
+    return "queue output/20240101_12000" + std::to_string(i) + ".png " + std::to_string(1000 + i) + " " + SHA_B + "\n";
+}
+
+static void test_full_manifest() {
+    // As worker.py's write_manifest() writes it
+    std::string text = std::string("version 1\n") +
+                       "latest 20240102_080000.png\n"
+                       "size 123456\n"
+                       "sha256 " + SHA_A + "\n"
+                       "raw 20240102_080000.raw4\n"
+                       "raw_version 2\n"
+                       "raw_size 98765\n"
+                       "raw_sha256 " + SHA_B + "\n"
+                       "delta 20240102_080000.delta4\n"
+                       "delta_base 20240101_120000.png\n"
+                       "delta_size 4321\n"
+                       "delta_sha256 " + SHA_A + "\n" +
+                       queueLine(0);
+
+    ImageManifest manifest;
+    TEST_ASSERT_TRUE(parse(text, &manifest));
+    TEST_ASSERT_EQUAL_STRING("20240102_080000.png", manifest.latest);
+    TEST_ASSERT_EQUAL_UINT32(123456, manifest.size);
+    TEST_ASSERT_EQUAL_STRING(SHA_A, manifest.sha256);
+    TEST_ASSERT_EQUAL_STRING("20240102_080000.raw4", manifest.raw);
+    TEST_ASSERT_EQUAL_UINT8(2, manifest.rawVersion);
+    TEST_ASSERT_EQUAL_UINT32(98765, manifest.rawSize);
+    TEST_ASSERT_EQUAL_STRING(SHA_B, manifest.rawSha256);
+    TEST_ASSERT_EQUAL_STRING("20240102_080000.delta4", manifest.delta);
+    TEST_ASSERT_EQUAL_STRING("20240101_120000.png", manifest.deltaBase);
+    TEST_ASSERT_EQUAL_UINT32(4321, manifest.deltaSize);
+    TEST_ASSERT_EQUAL_STRING(SHA_A, manifest.deltaSha256);
+    TEST_ASSERT_EQUAL_INT(1, manifest.queueCount);
+    TEST_ASSERT_EQUAL_STRING("output/20240101_120000.png", manifest.queue[0].path);
+    TEST_ASSERT_EQUAL_UINT32(1000, manifest.queue[0].size);
+    TEST_ASSERT_EQUAL_STRING(SHA_B, manifest.queue[0].sha256);
+    TEST_ASSERT_EQUAL_INT(0, manifest.dir[0]);  // Set by the caller, not the manifest
+}
+
+static void test_minimal_and_loose_lines() {
+    // CRLF, comments, blank lines, extra spaces, unknown keys, no final newline
+    std::string text = "# published by worker.py\r\n"
+                       "\r\n"
+                       "  version   1  \r\n"
+                       "future_key some value\r\n"
+                       "nokey\r\n"
+                       " latest 20240102_080000.png";
+
+    ImageManifest manifest;
+    TEST_ASSERT_TRUE(parse(text, &manifest));
+    TEST_ASSERT_EQUAL_STRING("20240102_080000.png", manifest.latest);
+    TEST_ASSERT_EQUAL_UINT32(0, manifest.size);
+    TEST_ASSERT_EQUAL_INT(0, manifest.sha256[0]);
+    TEST_ASSERT_EQUAL_INT(0, manifest.raw[0]);
+    TEST_ASSERT_EQUAL_INT(0, manifest.queueCount);
+}
+
+static void test_rejected() {
+    ImageManifest manifest;
+    TEST_ASSERT_FALSE(parse("latest a.png\n", &manifest));             // No version
+    TEST_ASSERT_FALSE(parse("version 2\nlatest a.png\n", &manifest));  // Newer format
+    TEST_ASSERT_FALSE(parse("version 1\nsize 10\n", &manifest));       // No latest image
+    TEST_ASSERT_FALSE(parse("", &manifest));
+
+    // A latest name too long for the field is dropped, not truncated
+    TEST_ASSERT_FALSE(parse("version 1\nlatest " + std::string(sizeof(manifest.latest), 'x') + "\n", &manifest));
+    TEST_ASSERT_TRUE(parse("version 1\nlatest " + std::string(sizeof(manifest.latest) - 1, 'x') + "\n", &manifest));
+}
+
+static void test_length_bounds_text() {
+    // Only length bytes are read: what follows is not part of the manifest
+    std::string text = "version 1\nlatest a.png\nlatest b.png\n";
+    ImageManifest manifest;
+    TEST_ASSERT_TRUE(parseManifest(text.data(), strlen("version 1\nlatest a.png\n"), &manifest));
+    TEST_ASSERT_EQUAL_STRING("a.png", manifest.latest);
+}
+
+static void test_queue_limit() {
+    // Keeps the first SLIDESHOW_SIZE entries; an entry without a usable path takes no slot
+    std::string text = "version 1\nlatest 20240102_080000.png\nqueue " + std::string(48, 'p') + " 10 " + SHA_A + "\n";
+    for (int i = 0; i < SLIDESHOW_SIZE + 2; i++) {
+        text += queueLine(i);
+    }
+
+    ImageManifest manifest;
+    TEST_ASSERT_TRUE(parse(text, &manifest));
+    TEST_ASSERT_EQUAL_INT(SLIDESHOW_SIZE, manifest.queueCount);
+    for (int i = 0; i < SLIDESHOW_SIZE; i++) {
+        TEST_ASSERT_EQUAL_STRING(("output/20240101_12000" + std::to_string(i) + ".png").c_str(), manifest.queue[i].path);
+        TEST_ASSERT_EQUAL_UINT32(1000 + i, manifest.queue[i].size);
+        TEST_ASSERT_EQUAL_STRING(SHA_B, manifest.queue[i].sha256);
+    }
+}
+
+static void test_queue_partial_entry() {
+    ImageManifest manifest;
+    TEST_ASSERT_TRUE(parse("version 1\nlatest a.png\nqueue output/b.png\n", &manifest));
+    TEST_ASSERT_EQUAL_INT(1, manifest.queueCount);
+    TEST_ASSERT_EQUAL_STRING("output/b.png", manifest.queue[0].path);
+    TEST_ASSERT_EQUAL_UINT32(0, manifest.queue[0].size);
+    TEST_ASSERT_EQUAL_INT(0, manifest.queue[0].sha256[0]);
+}
+
+static void test_numbers() {
+    ImageManifest manifest;
+    TEST_ASSERT_TRUE(parse("version 1\nlatest a.png\nsize 4294967295\nraw_size 99999999999\ndelta_size 12abc\n", &manifest));
+    TEST_ASSERT_EQUAL_UINT32(4294967295u, manifest.size);
+    TEST_ASSERT_EQUAL_UINT32(4294967295u, manifest.rawSize);  // Saturated
+    TEST_ASSERT_EQUAL_UINT32(12, manifest.deltaSize);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_full_manifest);
+    RUN_TEST(test_minimal_and_loose_lines);
+    RUN_TEST(test_rejected);
+    RUN_TEST(test_length_bounds_text);
+    RUN_TEST(test_queue_limit);
+    RUN_TEST(test_queue_partial_entry);
+    RUN_TEST(test_numbers);
+    return UNITY_END();
+}
@@ -10,6 +10,15 @@ import os
 import sys
 import time
 import shutil
+import hashlib
+import struct
+import zlib
+import argparse
+import json
+import ctypes
+import select
+import subprocess
+from concurrent.futures import ProcessPoolExecutor
 from pathlib import Path
 from PIL import Image, ImageOps, ImageEnhance, ImageFilter
 import numpy as np
@@ -20,6 +29,71 @@ IMAGE_DIR = Path("image")
 OUTPUT_DIR = Path("output")
 TARGET_WIDTH = 540
 TARGET_HEIGHT = 960
+MANIFEST_PATH = IMAGE_DIR / "manifest.txt"
+MANIFEST_VERSION = 1
+MANIFEST_QUEUE = 15  # Previous images listed for the device's slideshow (it caches what fits)
+MANIFEST_MAX_SIZE = 3072  # Largest manifest the firmware accepts (MANIFEST_MAX_SIZE in src/main.cpp)
+
+# Raw 4bpp format read directly by the firmware (no PNG decode on the device):
+# 16-byte little-endian header, then rows of packed pixels, two per byte,
+# left pixel in the high nibble, 0 = black ... 15 = white
+# Version 2 stores the same pixels as one LZ4 block
+RAW_EXTENSION = ".raw4"
+RAW_MAGIC = b"EPD4"
+RAW_VERSION = 1
+RAW_VERSION_LZ4 = 2
+RAW_HEADER = struct.Struct("<4sBBHHHI")  # magic, version, flags, width, height, reserved, crc32
+WRITE_RAW = True  # Disabled with --no-raw
+RAW_LZ4 = True  # LZ4-compressed raw (version 2); plain version 1 with --raw-plain
+LZ4_SEARCH_DEPTH = 64  # Match candidates tried per position: deeper is smaller and slower
+
+# Delta of the latest image against the previous one, for a device that still has
+# the previous one: 48-byte little-endian header, a bitmap of the changed tiles
+# (row-major, most significant bit first), then their packed rows as one LZ4 block
+DELTA_EXTENSION = ".delta4"
+DELTA_MAGIC = b"EPDD"
+DELTA_VERSION = 1
+DELTA_HEADER = struct.Struct("<4sBBHHHI32s")  # magic, version, tile size, width, height, changed tiles, crc32, base
+DELTA_TILE = 30  # Same grid as the firmware's partial refresh tiles
+WRITE_DELTA = True  # Disabled with --no-delta
+
+# Native Floyd-Steinberg kernel, compiled on first use with the system C compiler
+NATIVE_DIR = Path(__file__).resolve().parent / "native"
+DITHER_SOURCE = NATIVE_DIR / "dither.c"
+DITHER_LIBRARY = NATIVE_DIR / "build" / "libdither.so"
+DITHER_KERNEL = "auto"  # auto (native if it builds, else python), native or python; set with --dither-kernel
+_dither_native = None
+JOBS = os.cpu_count() or 1  # Images processed in parallel; set with --jobs
+
+# Processing parameters: changing any of them reprocesses every input
+UNSHARP_RADIUS = 2.0
+UNSHARP_AMOUNT = 1.2
+GAMMA = 0.85
+PIPELINE_VERSION = 2  # Bump when the processing code changes its output
+
+# Index of converted inputs: "<input content hash> <output PNG>" -> pipeline hash
+# (keyed by both: inputs with the same content still get one PNG each)
+CACHE_PATH = Path("cache.json")
+CACHE_VERSION = 2
+
+# Fleet: each subfolder of input/ is a device's own image set, published in
+# image/<device>/ (archived to output/<device>/) for the unit whose DEVICE_ID is
+# the folder name; units without one show the shared image/
+SHARED_DIRS = (INPUT_DIR, IMAGE_DIR, OUTPUT_DIR, CACHE_PATH)
+DEVICE_ID_MAX = 20  # Longest name that fits the firmware's queue paths
+DEVICE_ID_CHARS = set("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-")
+
+# Watch mode: input folders watched with inotify on Linux (a cheap scan of their
+# entries elsewhere); a batch is processed once no event came for WATCH_DEBOUNCE_S,
+# so an upload still being written is not picked up halfway
+WATCH_DEBOUNCE_S = 0.3
+WATCH_POLL_S = 0.5  # Scan interval without inotify
+IN_MODIFY, IN_CLOSE_WRITE, IN_MOVED_FROM, IN_MOVED_TO, IN_CREATE, IN_DELETE = 0x2, 0x8, 0x40, 0x80, 0x100, 0x200
+INOTIFY_MASK = IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_CREATE | IN_DELETE
+
+# Hashes of the inputs seen so far: path -> ((size, mtime), sha256), so repeated
+# passes only read files that are new or changed
+INPUT_HASHES = {}
 
 def center_crop(img, target_width, target_height):
     """
@@ -52,45 +126,31 @@ def apply_unsharp_mask(img, radius=2.0, amount=1.2):
     """
     return img.filter(ImageFilter.UnsharpMask(radius=radius, percent=int(amount * 100), threshold=3))
 
-def apply_gamma_correction(img, gamma=0.85):
+def gamma_levels_lut(gray, gamma=0.85):
     """
-    Apply gamma correction optimized for e-paper display
+    256-entry float32 table mapping each uint8 level of gray to its final
+    pre-dither value: gamma correction followed by auto-levels
+
+    Gamma correction is optimized for e-paper display:
     gamma < 1.0 expands highlights (more detail in bright areas)
     gamma > 1.0 expands shadows
-
     E-paper displays compress highlights, so we use gamma=0.85 to compensate
     without burning out highlight details
-    """
-    pixels = np.array(img, dtype=np.float32) / 255.0
-
-    # Apply gamma curve
-    pixels = np.power(pixels, gamma)
-
-    pixels = (pixels * 255.0).astype(np.uint8)
-    return Image.fromarray(pixels, mode='L')
 
-def auto_levels(img):
+    Auto-levels works like Photoshop: stretch the histogram to the full 0-255
+    range, mapping the darkest pixel to 0 and the brightest to 255. Both steps
+    only depend on the pixel's level, so they fuse into one table and nothing
+    is quantized between them.
     """
-    Auto-levels adjustment like Photoshop: stretch histogram to use full 0-255 range
-    Maps darkest pixel to 0 and brightest pixel to 255
-    """
-    pixels = np.array(img, dtype=np.float32)
-
-    # Find current min and max values
-    min_val = pixels.min()
-    max_val = pixels.max()
+    lut = np.power(np.arange(256, dtype=np.float32) / np.float32(255.0), np.float32(gamma)) * np.float32(255.0)
 
-    # If already using full range, skip
-    if min_val == 0 and max_val == 255:
-        return img
-
-    # Stretch histogram to 0-255
-    # Formula: (pixel - min) * 255 / (max - min)
+    # Gamma is monotonic: the darkest and brightest output levels come from the input's extremes
+    min_val = lut[gray.min()]
+    max_val = lut[gray.max()]
     if max_val > min_val:  # Avoid division by zero
-        pixels = (pixels - min_val) * 255.0 / (max_val - min_val)
+        lut = (lut - min_val) * (np.float32(255.0) / (max_val - min_val))
 
-    pixels = np.clip(pixels, 0, 255).astype(np.uint8)
-    return Image.fromarray(pixels, mode='L')
+    return np.clip(lut, 0, 255).astype(np.float32)
 
 def color_aware_grayscale(img):
     """
@@ -101,10 +161,11 @@ def color_aware_grayscale(img):
     if img.mode != 'RGB':
         img = img.convert('RGB')
 
-    r, g, b = img.split()
-    r_data = np.array(r, dtype=np.float32)
-    g_data = np.array(g, dtype=np.float32)
-    b_data = np.array(b, dtype=np.float32)
+    # One float32 copy of the image, channels as views into it
+    rgb = np.asarray(img, dtype=np.float32)
+    r_data = rgb[:, :, 0]
+    g_data = rgb[:, :, 1]
+    b_data = rgb[:, :, 2]
 
     # Standard luminosity
     luminosity = 0.299 * r_data + 0.587 * g_data + 0.114 * b_data
@@ -124,35 +185,24 @@ def color_aware_grayscale(img):
     result = np.clip(result, 0, 255).astype(np.uint8)
     return Image.fromarray(result, mode='L')
 
-def convert_to_4bit_grayscale(img):
+def dither_python(pixels):
     """
-    Convert image to 4-bit grayscale (16 levels) with Floyd-Steinberg dithering
-    Uses manual dithering implementation for better control
-    Optimized for e-paper display characteristics
+    Floyd-Steinberg dithering to 16 levels, in place on a float32 array
+    Reference implementation: the native kernel must match it bit for bit
     """
-    # Convert to grayscale with color awareness
-    img = color_aware_grayscale(img)
-
-    # Apply unsharp mask FIRST to enhance fine details and texture
-    img = apply_unsharp_mask(img, radius=2.0, amount=1.2)
-
-    # Apply gamma correction (expands highlights without burning)
-    img = apply_gamma_correction(img, gamma=0.85)
-
-    # Then auto-levels to remap to full 0-255 range
-    img = auto_levels(img)
-
-    # Convert to numpy array for manipulation
-    pixels = np.array(img, dtype=np.float32)
     height, width = pixels.shape
 
-    # Floyd-Steinberg dithering
+    # float32 constants: NumPy 1.x would compute float32 scalar * Python int in float64
+    step = np.float32(17)
+    sixteenth = np.float32(16)
+    w1, w3, w5, w7 = np.float32(1), np.float32(3), np.float32(5), np.float32(7)
+
     for y in range(height):
         for x in range(width):
             old_pixel = pixels[y, x]
 
             # Quantize to 16 levels (0, 17, 34, ..., 255)
-            new_pixel = np.round(old_pixel / 17) * 17
+            new_pixel = np.round(old_pixel / step) * step
             pixels[y, x] = new_pixel
 
             # Calculate quantization error
@@ -160,13 +210,78 @@ def convert_to_4bit_grayscale(img):
 
             # Distribute error to neighboring pixels
             if x + 1 < width:
-                pixels[y, x + 1] += error * 7 / 16
+                pixels[y, x + 1] += error * w7 / sixteenth
             if y + 1 < height:
                 if x > 0:
-                    pixels[y + 1, x - 1] += error * 3 / 16
-                pixels[y + 1, x] += error * 5 / 16
+                    pixels[y + 1, x - 1] += error * w3 / sixteenth
+                pixels[y + 1, x] += error * w5 / sixteenth
                 if x + 1 < width:
-                    pixels[y + 1, x + 1] += error * 1 / 16
+                    pixels[y + 1, x + 1] += error * w1 / sixteenth
+
+def load_native_dither():
+    """
+    Build native/dither.c into a shared library if it is missing or stale and
+    load it, returning the dither function or None if no C compiler works
+    """
+    if not DITHER_LIBRARY.exists() or DITHER_LIBRARY.stat().st_mtime < DITHER_SOURCE.stat().st_mtime:
+        DITHER_LIBRARY.parent.mkdir(exist_ok=True)
+        # No -ffast-math and no FMA contraction: results must match the float32 Python loop
+        cmd = [os.environ.get("CC", "cc"), "-O2", "-std=c99", "-ffp-contract=off", "-fPIC", "-shared",
+               "-o", str(DITHER_LIBRARY), str(DITHER_SOURCE), "-lm"]
+        try:
+            subprocess.run(cmd, check=True, capture_output=True, text=True)
+        except (OSError, subprocess.CalledProcessError) as e:
+            print(f"Could not build native dither kernel: {getattr(e, 'stderr', None) or e}")
+            return None
+
+    lib = ctypes.CDLL(str(DITHER_LIBRARY))
+    lib.dither_fs16.argtypes = [ctypes.POINTER(ctypes.c_float), ctypes.c_int, ctypes.c_int]
+    lib.dither_fs16.restype = None
+
+    def dither(pixels):
+        height, width = pixels.shape
+        lib.dither_fs16(pixels.ctypes.data_as(ctypes.POINTER(ctypes.c_float)), width, height)
+
+    return dither
+
+def get_dither_kernel():
+    """
+    Dither function selected by DITHER_KERNEL (built and loaded once)
+    """
+    global _dither_native
+
+    if DITHER_KERNEL == "python":
+        return dither_python
+
+    if _dither_native is None:
+        _dither_native = load_native_dither() or False
+        if _dither_native:
+            print("Using native dither kernel")
+        elif DITHER_KERNEL == "native":
+            sys.exit("Native dither kernel unavailable")
+        else:
+            print("Falling back to the Python dither kernel")
+
+    return _dither_native or dither_python
+
+def convert_to_4bit_grayscale(img):
+    """
+    Convert image to 4-bit grayscale (16 levels) with Floyd-Steinberg dithering
+    Uses manual dithering implementation for better control
+    Optimized for e-paper display characteristics
+    """
+    # Convert to grayscale with color awareness
+    img = color_aware_grayscale(img)
+
+    # Apply unsharp mask FIRST to enhance fine details and texture
+    img = apply_unsharp_mask(img, radius=UNSHARP_RADIUS, amount=UNSHARP_AMOUNT)
+
+    # Gamma correction (expands highlights without burning) and auto-levels
+    # (remap to the full 0-255 range) in one lookup into the float32 working
+    # buffer that is then dithered in place
+    gray = np.asarray(img)
+    pixels = gamma_levels_lut(gray, gamma=GAMMA)[gray]
+    get_dither_kernel()(pixels)
 
     # Clip values to valid range and convert back
     pixels = np.clip(pixels, 0, 255).astype(np.uint8)
@@ -174,6 +289,196 @@ def convert_to_4bit_grayscale(img):
 
     return img
 
+def pack_4bpp(img):
+    """
+    Pack a 16-level grayscale image (values 0, 17, ..., 255) into 4bpp rows,
+    two pixels per byte with the left pixel in the high nibble
+    """
+    levels = np.round(np.array(img, dtype=np.float32) / 17.0).astype(np.uint8)
+    return ((levels[:, 0::2] << 4) | levels[:, 1::2]).tobytes()
+
+def lz4_emit(out, literals, offset, length):
+    """
+    Append one LZ4 sequence: literals, then a match (none for the last sequence)
+    """
+    literal_count = len(literals)
+    match_extra = length - 4 if length else 0
+    out.append((min(literal_count, 15) << 4) | min(match_extra, 15))
+    if literal_count >= 15:
+        rest = literal_count - 15
+        out += b"\xff" * (rest // 255)
+        out.append(rest % 255)
+    out += literals
+    if length:
+        out += struct.pack("<H", offset)
+        if match_extra >= 15:
+            rest = match_extra - 15
+            out += b"\xff" * (rest // 255)
+            out.append(rest % 255)
+
+def lz4_compress(data, depth=None):
+    """
+    Compress into one LZ4 block (readable by any LZ4 block decoder)
+    Hash chains over 4-byte prefixes, trying the latest `depth` candidates in the
+    64 KB window, with one step of lazy matching: dithered pixels seldom repeat
+    exactly, so finding the longest match matters more than encoding speed
+    """
+    depth = depth or LZ4_SEARCH_DEPTH
+    n = len(data)
+    out = bytearray()
+    head = {}            # 4-byte prefix -> latest position
+    chain = [-1] * n     # Position -> previous position with the same prefix
+    match_end = n - 12   # No match may start in the last 12 bytes
+    literal_end = n - 5  # or cover the last 5 (LZ4 end of block rules)
+
+    def insert(pos):
+        key = data[pos:pos + 4]
+        chain[pos] = head.get(key, -1)
+        head[key] = pos
+
+    def longest_match(pos):
+        best_length, best_offset = 0, 0
+        candidate = head.get(data[pos:pos + 4], -1)
+        max_length = literal_end - pos
+        for _ in range(depth):
+            if candidate < 0 or pos - candidate > 0xFFFF:
+                break
+            length = 4
+            while length + 16 <= max_length and \
+                    data[candidate + length:candidate + length + 16] == data[pos + length:pos + length + 16]:
+                length += 16
+            while length < max_length and data[candidate + length] == data[pos + length]:
+                length += 1
+            if length > best_length:
+                best_length, best_offset = length, pos - candidate
+                if length == max_length:
+                    break
+            candidate = chain[candidate]
+        return best_length, best_offset
+
+    anchor = pos = 0
+    while pos < match_end:
+        length, offset = longest_match(pos)
+        insert(pos)
+        if not length:
+            pos += 1
+            continue
+
+        # A longer match one byte later is worth one more literal
+        if pos + 1 < match_end:
+            next_length, next_offset = longest_match(pos + 1)
+            if next_length > length + 1:
+                pos += 1
+                length, offset = next_length, next_offset
+                insert(pos)
+
+        lz4_emit(out, data[anchor:pos], offset, length)
+        for covered in range(pos + 1, min(pos + length, match_end)):
+            insert(covered)
+        pos += length
+        anchor = pos
+
+    lz4_emit(out, data[anchor:], 0, 0)
+    return bytes(out)
+
+def save_raw(img, raw_path, lz4=None):
+    """
+    Save image in the raw 4bpp format: header with version, dimensions and CRC-32
+    of the pixel data, followed by the packed pixels (as an LZ4 block for version 2)
+    """
+    lz4 = RAW_LZ4 if lz4 is None else lz4
+    width, height = img.size
+    pixels = pack_4bpp(img)
+    version = RAW_VERSION_LZ4 if lz4 else RAW_VERSION
+    header = RAW_HEADER.pack(RAW_MAGIC, version, 0, width, height, 0, zlib.crc32(pixels))
+    raw_path.write_bytes(header + (lz4_compress(pixels) if lz4 else pixels))
+    print(f"Saved to {raw_path}")
+
+def raw_version(raw_path):
+    """
+    Format version in a raw file's header (None if it is not a raw file)
+    """
+    header = raw_path.read_bytes()[:RAW_HEADER.size]
+    if len(header) < RAW_HEADER.size or header[:4] != RAW_MAGIC:
+        return None
+    return RAW_HEADER.unpack(header)[1]
+
+def save_delta(img, base_img, base_name, delta_path):
+    """
+    Save the tiles of img that differ from base_img (the image published before it)
+    with the CRC-32 of the whole result, so the device can patch its copy of the
+    base instead of downloading img
+    Writes nothing and returns False when the delta would not be smaller than the
+    raw file it replaces
+    """
+    width, height = img.size
+    if base_img.size != img.size or width % DELTA_TILE or height % DELTA_TILE:
+        return False
+
+    pixels = pack_4bpp(img)
+    row = DELTA_TILE // 2
+
+    def tiles(packed):
+        # (tiles down, tiles across, rows, bytes per row)
+        grid = np.frombuffer(packed, np.uint8).reshape(height // DELTA_TILE, DELTA_TILE, width // DELTA_TILE, row)
+        return grid.swapaxes(1, 2)
+
+    new_tiles = tiles(pixels)
+    changed = (new_tiles != tiles(pack_4bpp(base_img))).any(axis=(2, 3))
+    raw_path = delta_path.with_suffix(RAW_EXTENSION)
+    limit = raw_path.stat().st_size if raw_path.exists() else RAW_HEADER.size + len(pixels)
+    if changed.sum() * DELTA_TILE * row >= limit:
+        return False  # Most of the image changed: not worth compressing to find out
+
+    header = DELTA_HEADER.pack(DELTA_MAGIC, DELTA_VERSION, DELTA_TILE, width, height, int(changed.sum()),
+                               zlib.crc32(pixels), base_name.encode()[:32])
+    content = header + np.packbits(changed.ravel()).tobytes() + lz4_compress(new_tiles[changed].tobytes())
+
+    if len(content) >= limit:
+        print(f"No delta: {changed.sum()}/{changed.size} tiles changed")
+        return False
+    delta_path.write_bytes(content)
+    print(f"Saved to {delta_path} ({changed.sum()}/{changed.size} tiles changed)")
+    return True
+
+def delta_base(delta_path):
+    """
+    Name of the image a delta file applies to (None if it is not a delta file)
+    """
+    header = delta_path.read_bytes()[:DELTA_HEADER.size]
+    if len(header) < DELTA_HEADER.size or header[:4] != DELTA_MAGIC:
+        return None
+    return DELTA_HEADER.unpack(header)[7].rstrip(b"\0").decode()
+
+def update_delta(latest, previous):
+    """
+    Keep image/<latest>.delta4 against the image devices were shown before it, and
+    drop deltas of other images
+    previous is the latest image before this run processed anything (None when it
+    processed nothing: the delta on disk is still right)
+    """
+    delta_path = latest.with_suffix(DELTA_EXTENSION)
+    for delta_file in IMAGE_DIR.glob("*" + DELTA_EXTENSION):
+        if delta_file != delta_path:
+            delta_file.unlink()
+            print(f"Removed {delta_file.name}")
+
+    if WRITE_DELTA and previous is None:
+        return
+
+    # A reprocessed latest image keeps the base of its current delta
+    base = None
+    if previous is not None and previous.name != latest.name:
+        base = OUTPUT_DIR / previous.name
+    elif delta_path.exists() and delta_base(delta_path):
+        base = OUTPUT_DIR / delta_base(delta_path)
+
+    if delta_path.exists():
+        delta_path.unlink()
+    if not WRITE_DELTA or base is None or not base.exists():
+        return
+    save_delta(Image.open(latest).convert('L'), Image.open(base).convert('L'), base.name, delta_path)
+
 def process_image(input_path, output_path):
     """
     Process a single image: crop, resize, convert to 4-bit grayscale
@@ -205,6 +510,10 @@ def process_image(input_path, output_path):
     img.save(output_path, 'PNG', optimize=True)
     print(f"Saved to {output_path}")
 
+    # The raw copy is encoded once, for the image that stays latest (final cleanup);
+    # one left from an earlier conversion no longer matches the PNG
+    output_path.with_suffix(RAW_EXTENSION).unlink(missing_ok=True)
+
 def get_latest_image_in_folder(folder):
     """
     Get the latest image file in a folder (by filename, assuming YYYYMMDD_HHMMSS.jpg format)
@@ -234,12 +543,176 @@ def archive_old_images():
     for img_file in image_files:
         archive_path = OUTPUT_DIR / img_file.name
         shutil.move(str(img_file), str(archive_path))
-        print(f"Archived {img_file.name} to output/")
+        print(f"Archived {img_file.name} to {OUTPUT_DIR}/")
+
+def write_manifest():
+    """
+    Write image/manifest.txt describing the latest image in image/ and the
+    previous ones queued for the slideshow
+    The device fetches this small file from raw.githubusercontent.com on the same
+    connection it uses for the image, instead of listing image/ via the GitHub API
+    Only rewrites the file when its content changes, to avoid empty commits
+    """
+    image_files = sorted(IMAGE_DIR.glob("*.png")) + sorted(IMAGE_DIR.glob("*.PNG"))
+    image_files = [f for f in image_files if f.name != '.gitkeep']
+
+    if not image_files:
+        return
+
+    latest = sorted(image_files)[-1]
+    data = latest.read_bytes()
+
+    content = (
+        f"version {MANIFEST_VERSION}\n"
+        f"latest {latest.name}\n"
+        f"size {len(data)}\n"
+        f"sha256 {hashlib.sha256(data).hexdigest()}\n"
+    )
+
+    # Raw 4bpp variant, preferred by the device when its format version is supported
+    raw_path = latest.with_suffix(RAW_EXTENSION)
+    if raw_path.exists():
+        raw_data = raw_path.read_bytes()
+        content += (
+            f"raw {raw_path.name}\n"
+            f"raw_version {RAW_HEADER.unpack_from(raw_data)[1]}\n"
+            f"raw_size {len(raw_data)}\n"
+            f"raw_sha256 {hashlib.sha256(raw_data).hexdigest()}\n"
+        )
+
+    # Changed tiles only, for a device still holding the image published before this one
+    delta_path = latest.with_suffix(DELTA_EXTENSION)
+    if delta_path.exists():
+        delta_data = delta_path.read_bytes()
+        content += (
+            f"delta {delta_path.name}\n"
+            f"delta_base {delta_base(delta_path)}\n"
+            f"delta_size {len(delta_data)}\n"
+            f"delta_sha256 {hashlib.sha256(delta_data).hexdigest()}\n"
+        )
+
+    # Previous images, newest first: the device prefetches these for its offline slideshow
+    archived = sorted(list(OUTPUT_DIR.glob("*.png")) + list(OUTPUT_DIR.glob("*.PNG")), reverse=True)
+    # (the firmware's static_assert covers MANIFEST_QUEUE lines at its longest paths;
+    # stop early rather than publish a manifest it would reject)
+    for png in [f for f in archived if f.name != latest.name][:MANIFEST_QUEUE]:
+        queued = png.read_bytes()
+        line = f"queue {OUTPUT_DIR.as_posix()}/{png.name} {len(queued)} {hashlib.sha256(queued).hexdigest()}\n"
+        if len((content + line).encode()) > MANIFEST_MAX_SIZE:
+            break
+        content += line
+
+    if MANIFEST_PATH.exists() and MANIFEST_PATH.read_text() == content:
+        return
+
+    MANIFEST_PATH.write_text(content)
+    print(f"Updated manifest: {latest.name}")
+
+def pipeline_hash():
+    """
+    Hash of everything that determines the output for a given input
+    (the dither kernel is not included: all kernels give identical output)
+    """
+    params = {
+        "version": PIPELINE_VERSION,
+        "size": [TARGET_WIDTH, TARGET_HEIGHT],
+        "unsharp": [UNSHARP_RADIUS, UNSHARP_AMOUNT],
+        "gamma": GAMMA,
+    }
+    return hashlib.sha256(json.dumps(params, sort_keys=True).encode()).hexdigest()[:16]
+
+def file_sha256(path):
+    """
+    SHA-256 of a file's content, read in chunks
+    """
+    digest = hashlib.sha256()
+    with open(path, "rb") as f:
+        for chunk in iter(lambda: f.read(1 << 20), b""):
+            digest.update(chunk)
+    return digest.hexdigest()
+
+def input_sha256(path):
+    """
+    file_sha256() of an input, remembered by size and modification time
+    """
+    stat = path.stat()
+    key = (stat.st_size, stat.st_mtime_ns)
+    known = INPUT_HASHES.get(path)
+    if known and known[0] == key:
+        return known[1]
+    digest = file_sha256(path)
+    INPUT_HASHES[path] = (key, digest)
+    return digest
+
+def load_cache():
+    """
+    Load the processing cache (empty if missing, unreadable or of an unknown version)
+    """
+    try:
+        cache = json.loads(CACHE_PATH.read_text())
+        if cache.get("version") == CACHE_VERSION:
+            return cache["entries"]
+        if cache.get("version") == 1:
+            # Version 1 kept one output per content hash
+            return {cache_key(content_hash, entry["output"]): entry["pipeline"]
+                    for content_hash, entry in cache["entries"].items()}
+    except (OSError, ValueError, KeyError, TypeError):
+        pass
+    return {}
+
+def cache_key(content_hash, output_name):
+    """
+    Cache entry of one input converted to one output PNG
+    """
+    return f"{content_hash} {output_name}"
+
+def save_cache(entries):
+    """
+    Write the processing cache, only when its content changed
+    """
+    content = json.dumps({"version": CACHE_VERSION, "entries": entries}, indent=2, sort_keys=True) + "\n"
+    if CACHE_PATH.exists() and CACHE_PATH.read_text() == content:
+        return
+    CACHE_PATH.write_text(content)
+    print(f"Updated {CACHE_PATH}")
+
+def output_exists(name):
+    """
+    True if a processed PNG is still around, either as the latest image or archived
+    """
+    return (IMAGE_DIR / name).exists() or (OUTPUT_DIR / name).exists()
+
+def process_one(input_path, output_path):
+    """
+    Process one input image, reporting (not raising) errors so that one bad
+    file doesn't stop the rest of the batch
+    """
+    try:
+        # Process new image preserving the filename
+        process_image(input_path, output_path)
+        print(f"Processed {input_path.name} -> {output_path}")
+        return True
+    except Exception as e:
+        print(f"Error processing {input_path.name}: {e}")
+        import traceback
+        traceback.print_exc()
+        # Don't leave a half-written PNG behind
+        output_path.unlink(missing_ok=True)
+        return False
+
+def init_pool_worker(dither_kernel):
+    """
+    Carry the command line options into pool workers (needed where workers are
+    spawned rather than forked)
+    """
+    global DITHER_KERNEL
+    DITHER_KERNEL = dither_kernel
 
 def process_new_images():
     """
     Process all new images in input/ folder, preserving original filenames
-    Only processes images that don't already exist in image/ folder
+    Only processes images not already converted with the current parameters
+    (see cache.json), wherever their PNG now is
     Keeps original images in input/ folder
     """
     input_files = sorted(INPUT_DIR.glob("*.jpg")) + sorted(INPUT_DIR.glob("*.jpeg")) + \
@@ -252,33 +725,67 @@ def process_new_images():
     if not input_files:
         return  # Silently return, no new images
 
-    print(f"Found {len(input_files)} new image(s) in input/")
-
-    # Process images from oldest to newest (sorted by filename/timestamp)
-    for i, input_file in enumerate(input_files):
-        try:
-            # Keep original filename but change extension to .png
-            original_name = input_file.stem + ".png"
-            output_path = IMAGE_DIR / original_name
-
-            # Check if already processed
-            if output_path.exists():
-                print(f"Skipping {input_file.name} (already exists in image/)")
-                continue
-
-            # Archive old images (move previous image to output/)
-            archive_old_images()
+    print(f"Found {len(input_files)} image(s) in {INPUT_DIR}/")
+
+    # Skip inputs whose content was already converted with the current parameters,
+    # even after their PNG was archived to output/
+    cache = load_cache()
+    pipeline = pipeline_hash()
+    cached_outputs = {key.split(" ", 1)[1] for key in cache}
+    input_keys = {}
+    pending = []
+    for input_file in input_files:
+        # Keep original filename but change extension to .png
+        output_path = IMAGE_DIR / (input_file.stem + ".png")
+        key = input_keys[input_file] = cache_key(input_sha256(input_file), output_path.name)
+        entry = cache.get(key)
+
+        if entry is None and output_path.name not in cached_outputs and output_exists(output_path.name):
+            # Converted before the cache existed: adopt it rather than convert again
+            # (a cached output of other content means the input was replaced)
+            entry = cache[key] = pipeline
+        elif entry is None and output_path.name in cached_outputs:
+            print(f"Reprocessing {input_file.name} (content changed)")
+
+        if entry == pipeline and output_exists(output_path.name):
+            continue
+        if entry and entry != pipeline:
+            print(f"Reprocessing {input_file.name} (processing parameters changed)")
+        pending.append((input_file, output_path))
 
-            # Process new image preserving the filename
-            process_image(input_file, output_path)
+    # Forget inputs that are gone
+    live_keys = set(input_keys.values())
+    for key in [k for k in cache if k not in live_keys]:
+        del cache[key]
 
-            print(f"Processed {input_file.name} -> image/{original_name}")
+    # The image devices show until this run publishes another one: base of the next delta
+    published = sorted(IMAGE_DIR.glob("*.png")) + sorted(IMAGE_DIR.glob("*.PNG"))
+    previous = published[-1] if published and pending else None
 
-        except Exception as e:
-            print(f"Error processing {input_file.name}: {e}")
-            import traceback
-            traceback.print_exc()
-            continue
+    if not pending:
+        print("Nothing new to process")
+    else:
+        # Archive old images (move previous export from image/ to output/) once per batch;
+        # the final cleanup below archives all but the newest PNG
+        archive_old_images()
+
+        jobs = max(1, min(JOBS, len(pending)))
+        if jobs == 1:
+            results = [process_one(input_file, output_path) for input_file, output_path in pending]
+        else:
+            # Build the native kernel here so the workers don't all compile it at once
+            if DITHER_KERNEL != "python":
+                get_dither_kernel()
+            print(f"Processing {len(pending)} image(s) with {jobs} workers")
+            with ProcessPoolExecutor(max_workers=jobs, initializer=init_pool_worker,
+                                     initargs=(DITHER_KERNEL,)) as pool:
+                futures = [pool.submit(process_one, input_file, output_path)
+                           for input_file, output_path in pending]
+                results = [future.result() for future in futures]
+
+        for (input_file, output_path), ok in zip(pending, results):
+            if ok:
+                cache[input_keys[input_file]] = pipeline
 
     # Final cleanup: ensure only the latest image remains in image/
     print("\n=== Final cleanup: keeping only latest image ===")
@@ -290,21 +797,171 @@ def process_new_images():
         for img_file in image_files[:-1]:
             archive_path = OUTPUT_DIR / img_file.name
             shutil.move(str(img_file), str(archive_path))
-            print(f"Archived {img_file.name} to output/")
+            print(f"Archived {img_file.name} to {OUTPUT_DIR}/")
         print(f"Kept latest: {image_files[-1].name}")
 
-def watch_mode():
+    # Raw files are only for the device: drop those of archived images
+    # (they can be regenerated from the archived PNG)
+    latest_stem = image_files[-1].stem if image_files else None
+    for raw_file in IMAGE_DIR.glob("*" + RAW_EXTENSION):
+        if raw_file.stem != latest_stem:
+            raw_file.unlink()
+            print(f"Removed {raw_file.name}")
+
+    # Raw copy of the latest image: new, processed before raw output existed,
+    # or rewritten when the selected raw version changed
+    if WRITE_RAW and image_files:
+        raw_path = image_files[-1].with_suffix(RAW_EXTENSION)
+        if not raw_path.exists() or raw_version(raw_path) != (RAW_VERSION_LZ4 if RAW_LZ4 else RAW_VERSION):
+            save_raw(Image.open(image_files[-1]).convert('L'), raw_path)
+
+    if image_files:
+        update_delta(image_files[-1], previous)
+
+    write_manifest()
+    save_cache(cache)
+
+def fleet_devices():
+    """
+    Devices with their own image set: the subfolders of input/ with a usable name
+    """
+    devices = []
+    for folder in sorted(p for p in SHARED_DIRS[0].iterdir() if p.is_dir()):
+        if len(folder.name) > DEVICE_ID_MAX or not set(folder.name) <= DEVICE_ID_CHARS:
+            print(f"Skipping {folder}: device IDs are up to {DEVICE_ID_MAX} letters, digits, '_' or '-'")
+            continue
+        devices.append(folder.name)
+    return devices
+
+def select_device(device):
     """
-    Continuously watch input/ folder for new images
+    Point the input, image, output and cache paths at a device's image set
+    (None = the shared one)
+    """
+    global INPUT_DIR, IMAGE_DIR, OUTPUT_DIR, MANIFEST_PATH, CACHE_PATH
+    input_dir, image_dir, output_dir, cache_path = SHARED_DIRS
+    if device:
+        INPUT_DIR, IMAGE_DIR, OUTPUT_DIR = input_dir / device, image_dir / device, output_dir / device
+        CACHE_PATH = cache_path.with_name(f"{cache_path.stem}-{device}{cache_path.suffix}")
+        IMAGE_DIR.mkdir(parents=True, exist_ok=True)
+        OUTPUT_DIR.mkdir(parents=True, exist_ok=True)
+    else:
+        INPUT_DIR, IMAGE_DIR, OUTPUT_DIR, CACHE_PATH = input_dir, image_dir, output_dir, cache_path
+    MANIFEST_PATH = IMAGE_DIR / "manifest.txt"
+
+def process_fleet():
+    """
+    Process the shared image set, then each device's own
+    """
+    for device in [None] + fleet_devices():
+        select_device(device)
+        process_new_images()
+    select_device(None)
+
+def input_folders():
+    """
+    input/ and the device folders in it
+    """
+    root = SHARED_DIRS[0]
+    return [root] + sorted(p for p in root.iterdir() if p.is_dir())
+
+class InotifyWatcher:
+    """
+    Changes in the input folders from Linux inotify (through libc, no extra package)
+    """
+
+    def __init__(self):
+        self.libc = ctypes.CDLL(None, use_errno=True)
+        self.fd = self.libc.inotify_init1(os.O_NONBLOCK | os.O_CLOEXEC)
+        if self.fd < 0:
+            raise OSError(ctypes.get_errno(), "inotify_init1 failed")
+        self.watched = set()
+        self.refresh()
+
+    def refresh(self):
+        """
+        Watch device folders created since the last call
+        """
+        folders = set(input_folders())
+        self.watched &= folders  # The kernel drops the watch of a deleted folder
+        for folder in folders - self.watched:
+            if self.libc.inotify_add_watch(self.fd, os.fsencode(folder), INOTIFY_MASK) < 0:
+                raise OSError(ctypes.get_errno(), f"inotify_add_watch failed for {folder}")
+            self.watched.add(folder)
+
+    def wait(self, timeout):
+        """
+        True if something changed within timeout seconds (None = no limit)
+        """
+        ready, _, _ = select.select([self.fd], [], [], timeout)
+        if not ready:
+            return False
+        try:
+            while os.read(self.fd, 65536):
+                pass
+        except BlockingIOError:
+            pass
+        self.refresh()
+        return True
+
+class PollWatcher:
+    """
+    Changes in the input folders from a scan of their entries every WATCH_POLL_S
+    (sizes and times only, no file is read), where inotify is not available
+    """
+
+    def __init__(self):
+        self.state = self.scan()
+
+    def scan(self):
+        entries = []
+        for folder in input_folders():
+            with os.scandir(folder) as it:
+                for entry in it:
+                    stat = entry.stat()
+                    entries.append((entry.path, stat.st_size, stat.st_mtime_ns))
+        return sorted(entries)
+
+    def wait(self, timeout):
+        """
+        True if something changed within timeout seconds (None = no limit)
+        """
+        deadline = None if timeout is None else time.monotonic() + timeout
+        while True:
+            state = self.scan()
+            if state != self.state:
+                self.state = state
+                return True
+            if deadline is not None and time.monotonic() >= deadline:
+                return False
+            time.sleep(WATCH_POLL_S if deadline is None else min(WATCH_POLL_S, max(deadline - time.monotonic(), 0)))
+
+def make_watcher(poll=False):
+    if not poll:
+        try:
+            return InotifyWatcher()
+        except (AttributeError, OSError) as e:
+            print(f"inotify not available ({e}), scanning every {WATCH_POLL_S} s instead")
+    return PollWatcher()
+
+def watch_mode(poll=False):
+    """
+    Process input/ whenever something in it changes: idle until then, and
+    within WATCH_DEBOUNCE_S of the last write of an upload
     """
     print("Starting worker in watch mode...")
     print(f"Monitoring {INPUT_DIR.absolute()}")
     print("Press Ctrl+C to stop")
 
     try:
+        watcher = make_watcher(poll)
+        process_fleet()
         while True:
-            process_new_images()
-            time.sleep(5)  # Check every 5 seconds
+            watcher.wait(None)
+            # An upload still being written keeps producing events
+            while watcher.wait(WATCH_DEBOUNCE_S):
+                pass
+            process_fleet()
     except KeyboardInterrupt:
         print("\nWorker stopped")
 
@@ -312,16 +969,42 @@ def main():
     """
     Main entry point
     """
+    global WRITE_RAW, RAW_LZ4, WRITE_DELTA, DITHER_KERNEL, JOBS
+
+    parser = argparse.ArgumentParser(description="Image processing worker for M5PaperS3")
+    parser.add_argument("mode", nargs="?", choices=["run", "watch"], default="run",
+                        help="run once (default) or keep watching input/")
+    parser.add_argument("--poll", action="store_true",
+                        help=f"in watch mode, scan input/ every {WATCH_POLL_S} s instead of using inotify")
+    parser.add_argument("--no-raw", action="store_true",
+                        help=f"don't write the raw 4bpp ({RAW_EXTENSION}) copy next to each PNG")
+    parser.add_argument("--raw-plain", action="store_true",
+                        help="write uncompressed raw files (version 1) instead of LZ4 (version 2)")
+    parser.add_argument("--no-delta", action="store_true",
+                        help=f"don't write the changed-tiles delta ({DELTA_EXTENSION}) against the previous image")
+    parser.add_argument("--dither-kernel", choices=["auto", "native", "python"], default="auto",
+                        help="Floyd-Steinberg implementation: native C (bit-identical, much faster), "
+                             "python, or auto (native when a C compiler is available)")
+    parser.add_argument("--jobs", "-j", type=int, default=JOBS,
+                        help=f"images processed in parallel (default: {JOBS}, the CPU count)")
+    args = parser.parse_args()
+
+    WRITE_RAW = not args.no_raw
+    RAW_LZ4 = not args.raw_plain
+    WRITE_DELTA = not args.no_delta
+    DITHER_KERNEL = args.dither_kernel
+    JOBS = max(1, args.jobs)
+
     # Ensure directories exist
     INPUT_DIR.mkdir(exist_ok=True)
     IMAGE_DIR.mkdir(exist_ok=True)
     OUTPUT_DIR.mkdir(exist_ok=True)
 
-    if len(sys.argv) > 1 and sys.argv[1] == "watch":
-        watch_mode()
+    if args.mode == "watch":
+        watch_mode(args.poll)
     else:
         # Single run mode
-        process_new_images()
+        process_fleet()
 
 if __name__ == "__main__":
     main()